@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchLFPool.dir/bench/src/benchLFPool.cpp.o"
+  "CMakeFiles/benchLFPool.dir/bench/src/benchLFPool.cpp.o.d"
+  "benchLFPool"
+  "benchLFPool.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/benchLFPool.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/latencyLFPool.dir/bench/src/latencyLFPool.cpp.o"
+  "CMakeFiles/latencyLFPool.dir/bench/src/latencyLFPool.cpp.o.d"
+  "latencyLFPool"
+  "latencyLFPool.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/latencyLFPool.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/testLFPool.dir/test/src/lockFreePoolTest.cpp.o"
+  "CMakeFiles/testLFPool.dir/test/src/lockFreePoolTest.cpp.o.d"
+  "CMakeFiles/testLFPool.dir/test/src/mainPool.cpp.o"
+  "CMakeFiles/testLFPool.dir/test/src/mainPool.cpp.o.d"
+  "testLFPool"
+  "testLFPool.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/testLFPool.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
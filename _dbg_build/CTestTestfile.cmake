@@ -0,0 +1,10 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_dbg_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(testLFPool "/root/repo/_dbg_build/testLFPool")
+set_tests_properties(testLFPool PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;22;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(latencyLFPool "/root/repo/_dbg_build/latencyLFPool" "--rounds=2" "--live=2000")
+set_tests_properties(latencyLFPool PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;37;add_test;/root/repo/CMakeLists.txt;0;")
@@ -0,0 +1,411 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <algorithm>
+#include <memory_resource>
+
+#include "benchmark/benchmark.h"
+
+#include "types.h"
+#include "objectPool.h"
+#include "lockFreeStack.h"
+#include "lockFreeQueue.h"
+
+using namespace lfmem;
+
+namespace
+{
+
+constexpr pSzt batchSize = 64;
+
+template<pSzt Size> class Payload
+{
+    pInt _thrId;
+    pInt _nodId;
+    pChr _pad[ Size > 2 * sizeof( pInt ) ? Size - 2 * sizeof( pInt ) : 1 ];
+public:
+    Payload( pInt thrId, pInt nodId ) : _thrId( thrId ), _nodId( nodId ) { _pad[ 0 ] = 0; }
+
+    inline pInt NodeID() const { return( _nodId ); }
+};
+
+/**
+ * Allocators under test share one interface: Alloc/Free by thread id.
+ */
+template<typename T> struct LFPoolAlloc
+{
+    LockFreeObjPool<T> _pool;
+
+    T* Alloc( pInt thId, pInt n ) { return( _pool.Construct( ThreadHint( thId ), thId, n ) ); }
+    void Free( pInt /*thId*/, T* ptr ) { _pool.Destruct( ptr ); }
+};
+
+template<typename T> struct LFPoolMagazineAlloc
+{
+    LockFreeObjPool<T> _pool{ 64, 64 };
+
+    T* Alloc( pInt thId, pInt n ) { return( _pool.Construct( ThreadHint( thId ), thId, n ) ); }
+    void Free( pInt thId, T* ptr ) { _pool.Destruct( ThreadHint( thId ), ptr ); }
+};
+
+template<typename T> struct NewDeleteAlloc
+{
+    T* Alloc( pInt thId, pInt n ) { return( new T( thId, n ) ); }
+    void Free( pInt /*thId*/, T* ptr ) { delete ptr; }
+};
+
+template<typename T> struct PmrSyncPoolAlloc
+{
+    std::pmr::synchronized_pool_resource _resource;
+
+    T* Alloc( pInt thId, pInt n )
+    {
+        return( new ( _resource.allocate( sizeof( T ), alignof( T ) ) ) T( thId, n ) );
+    }
+    void Free( pInt /*thId*/, T* ptr )
+    {
+        ptr->~T();
+        _resource.deallocate( ptr, sizeof( T ), alignof( T ) );
+    }
+};
+
+/**
+ * State shared by the threads of one benchmark run: created by thread 0
+ * before the timed loop, destroyed by it afterwards.
+ */
+template<typename A> struct Shared
+{
+    static std::unique_ptr<A> instance;
+};
+template<typename A> std::unique_ptr<A> Shared<A>::instance;
+
+void threadSweep( benchmark::internal::Benchmark* b )
+{
+    pSzt maxThreads = std::max<pSzt>( std::thread::hardware_concurrency(), 2 );
+    for ( pSzt n( 1 ) ; n< maxThreads ; n *= 2 ) b->Threads( n );
+    b->Threads( maxThreads );
+    b->UseRealTime();
+}
+
+/**
+ * Up to four threads per hardware thread, for the oversubscribed case.
+ */
+void oversubscribedSweep( benchmark::internal::Benchmark* b )
+{
+    pSzt hwThreads = std::max<pSzt>( std::thread::hardware_concurrency(), 1 );
+    for ( pSzt n( 1 ) ; n< hwThreads ; n *= 2 ) b->Threads( n );
+    for ( pSzt n( hwThreads ) ; n<= 4 * hwThreads ; n *= 2 ) b->Threads( n );
+    b->UseRealTime();
+}
+
+/**
+ * Every thread allocates a batch and frees it in reverse order.
+ */
+template<template<typename> class A, pSzt Size> void BM_LifoSameThread( benchmark::State& state )
+{
+    using T = Payload<Size>;
+    if ( state.thread_index() == 0 ) Shared<A<T>>::instance = std::make_unique<A<T>>();
+    pInt thId = state.thread_index();
+    std::vector<T*> batch( batchSize );
+    for ( auto _ : state )
+    {
+        A<T>& alloc = *Shared<A<T>>::instance;
+        for ( pSzt i( 0 ) ; i< batchSize ; ++i ) batch[ i ] = alloc.Alloc( thId, i );
+        for ( pSzt i( batchSize ) ; i> 0 ; --i ) alloc.Free( thId, batch[ i - 1 ] );
+    }
+    state.SetItemsProcessed( state.iterations() * batchSize );
+    if ( state.thread_index() == 0 ) Shared<A<T>>::instance.reset();
+}
+
+/**
+ * Every thread allocates a larger batch and frees it in shuffled order.
+ */
+template<template<typename> class A, pSzt Size> void BM_RandomOrderFree( benchmark::State& state )
+{
+    using T = Payload<Size>;
+    constexpr pSzt nBatch = 4 * batchSize;
+    if ( state.thread_index() == 0 ) Shared<A<T>>::instance = std::make_unique<A<T>>();
+    pInt thId = state.thread_index();
+    std::vector<T*> batch( nBatch );
+    std::vector<pSzt> order( nBatch );
+    for ( pSzt i( 0 ) ; i< nBatch ; ++i ) order[ i ] = i;
+    std::mt19937 rng( thId + 1 );
+    std::shuffle( order.begin(), order.end(), rng );
+    for ( auto _ : state )
+    {
+        A<T>& alloc = *Shared<A<T>>::instance;
+        for ( pSzt i( 0 ) ; i< nBatch ; ++i ) batch[ i ] = alloc.Alloc( thId, i );
+        for ( pSzt i( 0 ) ; i< nBatch ; ++i ) alloc.Free( thId, batch[ order[ i ] ] );
+    }
+    state.SetItemsProcessed( state.iterations() * nBatch );
+    if ( state.thread_index() == 0 ) Shared<A<T>>::instance.reset();
+}
+
+/**
+ * Like test1: even threads allocate and push onto a LockFreeStack, odd
+ * threads pop and free, so objects are freed by a thread other than the
+ * one that allocated them. A single thread plays both roles.
+ */
+template<template<typename> class A, pSzt Size> void BM_ProducerConsumer( benchmark::State& state )
+{
+    using T = Payload<Size>;
+    struct Pipe
+    {
+        A<T> _alloc;
+        LockFreeStack<T> _stack;
+    };
+    if ( state.thread_index() == 0 ) Shared<Pipe>::instance = std::make_unique<Pipe>();
+    pInt thId = state.thread_index();
+    pBool producer = state.threads() == 1 || !( thId % 2 );
+    pBool consumer = state.threads() == 1 || ( thId % 2 );
+    for ( auto _ : state )
+    {
+        Pipe& pipe = *Shared<Pipe>::instance;
+        if ( producer )
+        {
+            for ( pSzt i( 0 ) ; i< batchSize ; ++i ) pipe._stack.Push( pipe._alloc.Alloc( thId, i ) );
+        }
+        if ( consumer )
+        {
+            for ( pSzt i( 0 ) ; i< batchSize ; ++i )
+            {
+                T* ptr = pipe._stack.Pop();
+                if ( !ptr ) break;
+                pipe._alloc.Free( thId, ptr );
+            }
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * batchSize );
+    if ( state.thread_index() == 0 )
+    {
+        Pipe& pipe = *Shared<Pipe>::instance;
+        while ( T* ptr = pipe._stack.Pop() ) pipe._alloc.Free( thId, ptr );
+        Shared<Pipe>::instance.reset();
+    }
+}
+
+struct BurstyTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<256, 2, 4096>;
+};
+
+template<typename T> struct LFPoolGrowthAlloc
+{
+    LockFreeObjPool<T, BurstyTraits> _pool;
+
+    T* Alloc( pInt thId, pInt n ) { return( _pool.Construct( ThreadHint( thId ), thId, n ) ); }
+    void Free( pInt /*thId*/, T* ptr ) { _pool.Destruct( ptr ); }
+};
+
+template<typename Backoff> struct BackoffTraits : DefaultPoolTraits
+{
+    using BackoffPolicy = Backoff;
+};
+
+/**
+ * LFPoolAlloc with the backoff policy of its CAS loops swapped.
+ */
+template<typename Backoff> struct LFPoolBackoff
+{
+    template<typename T> struct Type
+    {
+        LockFreeObjPool<T, BackoffTraits<Backoff>> _pool;
+
+        T* Alloc( pInt thId, pInt n ) { return( _pool.Construct( ThreadHint( thId ), thId, n ) ); }
+        void Free( pInt /*thId*/, T* ptr ) { _pool.Destruct( ptr ); }
+    };
+};
+
+using NoBackoffAlloc = LFPoolBackoff<NoBackoff>;
+using ExpBackoffAlloc = LFPoolBackoff<ExponentialBackoff<1, 64>>;
+using JitterBackoffAlloc = LFPoolBackoff<JitteredBackoff<1, 64>>;
+using YieldBackoffAlloc = LFPoolBackoff<YieldingBackoff<8, ExponentialBackoff<1, 64>>>;
+
+/**
+ * A fresh allocator per iteration takes a burst of objects, so pools pay
+ * for growing chunk by chunk from a small initial chunk.
+ */
+template<template<typename> class A, pSzt Size> void BM_BurstyGrowth( benchmark::State& state )
+{
+    using T = Payload<Size>;
+    constexpr pSzt nBurst = 16384;
+    std::vector<T*> burst( nBurst );
+    for ( auto _ : state )
+    {
+        A<T> alloc;
+        for ( pSzt i( 0 ) ; i< nBurst ; ++i ) burst[ i ] = alloc.Alloc( 0, i );
+        for ( pSzt i( 0 ) ; i< nBurst ; ++i ) alloc.Free( 0, burst[ i ] );
+    }
+    state.SetItemsProcessed( state.iterations() * nBurst );
+}
+
+template<typename T> struct MutexStack
+{
+    std::mutex _mtx;
+    std::vector<T*> _items;
+
+    void Push( T* ptr )
+    {
+        std::lock_guard<std::mutex> lock( _mtx );
+        _items.push_back( ptr );
+    }
+    T* Pop()
+    {
+        std::lock_guard<std::mutex> lock( _mtx );
+        if ( _items.empty() ) return( nullptr );
+        T* ptr = _items.back();
+        _items.pop_back();
+        return( ptr );
+    }
+};
+
+/**
+ * Push and pop of preallocated objects, the stack against a locked vector.
+ */
+template<template<typename> class S> void BM_StackPushPop( benchmark::State& state )
+{
+    using T = Payload<64>;
+    if ( state.thread_index() == 0 ) Shared<S<T>>::instance = std::make_unique<S<T>>();
+    std::vector<T> objs;
+    objs.reserve( batchSize );
+    for ( pSzt i( 0 ) ; i< batchSize ; ++i ) objs.emplace_back( state.thread_index(), i );
+    for ( auto _ : state )
+    {
+        S<T>& stack = *Shared<S<T>>::instance;
+        for ( T& obj : objs ) stack.Push( &obj );
+        for ( pSzt i( 0 ) ; i< batchSize ; ++i ) benchmark::DoNotOptimize( stack.Pop() );
+    }
+    state.SetItemsProcessed( state.iterations() * batchSize );
+    if ( state.thread_index() == 0 ) Shared<S<T>>::instance.reset();
+}
+
+template<typename T> using LFStack = LockFreeStack<T>;
+
+template<typename T> struct LFStackNoElimination : LockFreeStack<T>
+{
+    LFStackNoElimination() : LockFreeStack<T>( 0 ) {}
+};
+
+/**
+ * Transports for BM_Handoff; Put fails only when a bounded one is full.
+ */
+template<typename T> struct StackHandoff
+{
+    LockFreeStack<T> _stack;
+
+    pBool Put( T* ptr ) { _stack.Push( ptr ); return( true ); }
+    T* Take() { return( _stack.Pop() ); }
+};
+
+template<typename T> struct QueueHandoff
+{
+    LockFreeQueue<T> _queue{ 4096 };
+
+    pBool Put( T* ptr ) { return( _queue.Push( ptr ) ); }
+    T* Take() { return( _queue.Pop() ); }
+};
+
+template<typename T> struct QueueBatchHandoff : QueueHandoff<T> {};
+
+/**
+ * The producer/consumer workload with a pooled allocator and the transport 
+ * as variable: producers construct and hand over a batch, consumers take 
+ * a batch and destruct it. Objects that do not fit a full queue are freed 
+ * by the producer.
+ */
+template<template<typename> class H> void BM_Handoff( benchmark::State& state )
+{
+    using T = Payload<64>;
+    struct Pipe
+    {
+        LockFreeObjPool<T> _pool{ 64, 64 };
+        H<T> _handoff;
+    };
+    if ( state.thread_index() == 0 ) Shared<Pipe>::instance = std::make_unique<Pipe>();
+    pInt thId = state.thread_index();
+    pBool producer = state.threads() == 1 || !( thId % 2 );
+    pBool consumer = state.threads() == 1 || ( thId % 2 );
+    std::vector<T*> batch( batchSize );
+    for ( auto _ : state )
+    {
+        Pipe& pipe = *Shared<Pipe>::instance;
+        if ( producer )
+        {
+            for ( pSzt i( 0 ) ; i< batchSize ; ++i ) batch[ i ] = pipe._pool.Construct( ThreadHint( thId ), thId, i );
+            if constexpr ( std::is_same<H<T>, QueueBatchHandoff<T>>::value )
+            {
+                pSzt nPut = pipe._handoff._queue.PushBatch( batch.data(), batchSize );
+                for ( pSzt i( nPut ) ; i< batchSize ; ++i ) pipe._pool.Destruct( ThreadHint( thId ), batch[ i ] );
+            }
+            else
+            {
+                for ( T* ptr : batch ) if ( !pipe._handoff.Put( ptr ) ) pipe._pool.Destruct( ThreadHint( thId ), ptr );
+            }
+        }
+        if ( consumer )
+        {
+            pSzt nTaken( 0 );
+            if constexpr ( std::is_same<H<T>, QueueBatchHandoff<T>>::value )
+            {
+                nTaken = pipe._handoff._queue.PopBatch( batch.data(), batchSize );
+            }
+            else
+            {
+                while ( nTaken < batchSize && ( batch[ nTaken ] = pipe._handoff.Take() ) ) ++nTaken;
+            }
+            for ( pSzt i( 0 ) ; i< nTaken ; ++i ) pipe._pool.Destruct( ThreadHint( thId ), batch[ i ] );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * batchSize );
+    if ( state.thread_index() == 0 )
+    {
+        Pipe& pipe = *Shared<Pipe>::instance;
+        while ( T* ptr = pipe._handoff.Take() ) pipe._pool.Destruct( ptr );
+        Shared<Pipe>::instance.reset();
+    }
+}
+
+} // namespace
+
+#define LF_BENCH_ALLOCATORS( BM, SIZE )                                 \
+    BENCHMARK_TEMPLATE( BM, LFPoolAlloc, SIZE )->Apply( threadSweep );         \
+    BENCHMARK_TEMPLATE( BM, LFPoolMagazineAlloc, SIZE )->Apply( threadSweep ); \
+    BENCHMARK_TEMPLATE( BM, NewDeleteAlloc, SIZE )->Apply( threadSweep );      \
+    BENCHMARK_TEMPLATE( BM, PmrSyncPoolAlloc, SIZE )->Apply( threadSweep );
+
+LF_BENCH_ALLOCATORS( BM_LifoSameThread, 16 )
+LF_BENCH_ALLOCATORS( BM_LifoSameThread, 64 )
+LF_BENCH_ALLOCATORS( BM_LifoSameThread, 256 )
+LF_BENCH_ALLOCATORS( BM_RandomOrderFree, 64 )
+LF_BENCH_ALLOCATORS( BM_ProducerConsumer, 64 )
+
+BENCHMARK_TEMPLATE( BM_BurstyGrowth, LFPoolGrowthAlloc, 64 );
+BENCHMARK_TEMPLATE( BM_BurstyGrowth, NewDeleteAlloc, 64 );
+BENCHMARK_TEMPLATE( BM_BurstyGrowth, PmrSyncPoolAlloc, 64 );
+
+BENCHMARK_TEMPLATE( BM_RandomOrderFree, NoBackoffAlloc::Type, 64 )->Apply( oversubscribedSweep );
+BENCHMARK_TEMPLATE( BM_RandomOrderFree, ExpBackoffAlloc::Type, 64 )->Apply( oversubscribedSweep );
+BENCHMARK_TEMPLATE( BM_RandomOrderFree, JitterBackoffAlloc::Type, 64 )->Apply( oversubscribedSweep );
+BENCHMARK_TEMPLATE( BM_RandomOrderFree, YieldBackoffAlloc::Type, 64 )->Apply( oversubscribedSweep );
+
+BENCHMARK_TEMPLATE( BM_StackPushPop, LFStack )->Apply( threadSweep );
+BENCHMARK_TEMPLATE( BM_StackPushPop, LFStackNoElimination )->Apply( threadSweep );
+BENCHMARK_TEMPLATE( BM_StackPushPop, MutexStack )->Apply( threadSweep );
+
+BENCHMARK_TEMPLATE( BM_Handoff, StackHandoff )->Apply( threadSweep );
+BENCHMARK_TEMPLATE( BM_Handoff, QueueHandoff )->Apply( threadSweep );
+BENCHMARK_TEMPLATE( BM_Handoff, QueueBatchHandoff )->Apply( threadSweep );
+
+BENCHMARK_MAIN();
@@ -0,0 +1,257 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+#include <pthread.h>
+#include <sched.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define LF_HAVE_TSC 1
+#endif
+
+#include "types.h"
+#include "histogram.h"
+#include "objectPool.h"
+
+using namespace lfmem;
+
+/**
+ * Per-operation latency of Construct/Destruct under load. Measured threads
+ * fill up to --live objects, timing every Construct, then free them all,
+ * timing every Destruct, so chunk growth and contention stalls land in the
+ * tail. Background threads churn the same pool untimed. Exits with 1 if a
+ * --max-p999-ns limit is given and exceeded, so it can gate changes.
+ */
+
+namespace
+{
+
+class Payload
+{
+    pInt _thrId;
+    pInt _nodId;
+    pChr _pad[ 56 ];
+public:
+    Payload( pInt thrId, pInt nodId ) : _thrId( thrId ), _nodId( nodId ) { _pad[ 0 ] = 0; }
+};
+
+struct StandbyTraits : DefaultPoolTraits
+{
+    using ProvisionPolicy = StandbyChunks<1, 2, true>;
+};
+
+struct Options
+{
+    pSzt threads = 2;
+    pSzt loadThreads = 1;
+    pSzt rounds = 50;
+    pSzt live = 5000;
+    pSzt magazines = 0;
+    pBool standby = false;
+    pBool pin = true;
+    pBool tsc = true;
+    pBool verbose = false;
+    pSzt maxP999Ns = 0;
+};
+
+pBool parseArg( const pChr* arg, const pChr* name, pSzt& value )
+{
+    pSzt len = std::strlen( name );
+    if ( std::strncmp( arg, name, len ) || arg[ len ] != '=' ) return( false );
+    value = std::strtoull( arg + len + 1, nullptr, 10 );
+    return( true );
+}
+
+pBool parseOptions( pInt argc, pChr** argv, Options& opt )
+{
+    for ( pInt i( 1 ) ; i< argc ; ++i )
+    {
+        const pChr* arg = argv[ i ];
+        pSzt flag( 0 );
+        if ( parseArg( arg, "--threads", opt.threads ) || parseArg( arg, "--load", opt.loadThreads ) ||
+             parseArg( arg, "--rounds", opt.rounds ) || parseArg( arg, "--live", opt.live ) ||
+             parseArg( arg, "--magazines", opt.magazines ) || parseArg( arg, "--max-p999-ns", opt.maxP999Ns ) )
+        {
+            continue;
+        }
+        if ( parseArg( arg, "--standby", flag ) ) opt.standby = flag;
+        else if ( parseArg( arg, "--pin", flag ) ) opt.pin = flag;
+        else if ( parseArg( arg, "--tsc", flag ) ) opt.tsc = flag;
+        else if ( !std::strcmp( arg, "--verbose" ) ) opt.verbose = true;
+        else
+        {
+            std::cerr << "usage: " << argv[ 0 ] << " [--threads=N] [--load=N] [--rounds=N] [--live=N] [--magazines=N]\n"
+                      << "       [--standby=0|1] [--pin=0|1] [--tsc=0|1] [--max-p999-ns=N] [--verbose]\n";
+            return( false );
+        }
+    }
+    opt.threads = std::max<pSzt>( opt.threads, 1 );
+    // Magazines are single-owner: every measured and load thread needs its own.
+    if ( opt.magazines ) opt.magazines = std::max( opt.magazines, opt.threads + opt.loadThreads );
+    return( true );
+}
+
+/**
+ * Timestamps in ticks: rdtsc where available, steady_clock nanoseconds
+ * otherwise. NanosPerTick is calibrated against steady_clock.
+ */
+class TickClock
+{
+    pBool _tsc;
+    pDbl _nanosPerTick;
+
+public:
+    explicit TickClock( pBool tsc ) : _nanosPerTick( 1.0 )
+    {
+#ifdef LF_HAVE_TSC
+        _tsc = tsc;
+#else
+        _tsc = false;
+#endif
+        if ( !_tsc ) return;
+        auto t0 = std::chrono::steady_clock::now();
+        pSzt c0 = Now();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+        pSzt c1 = Now();
+        auto t1 = std::chrono::steady_clock::now();
+        _nanosPerTick = static_cast<pDbl>( std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count() ) / ( c1 - c0 );
+    }
+
+    inline pSzt Now() const
+    {
+#ifdef LF_HAVE_TSC
+        if ( _tsc ) return( __rdtsc() );
+#endif
+        return( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+    }
+    inline pSzt ToNanos( pSzt ticks ) const
+    {
+        return( static_cast<pSzt>( ticks * _nanosPerTick ) );
+    }
+    pBool UsesTsc() const { return( _tsc ); }
+};
+
+void pinThread( pSzt idx )
+{
+    pSzt nCpus = std::max<pSzt>( std::thread::hardware_concurrency(), 1 );
+    cpu_set_t cpus;
+    CPU_ZERO( &cpus );
+    CPU_SET( idx % nCpus, &cpus );
+    pthread_setaffinity_np( pthread_self(), sizeof( cpus ), &cpus );
+}
+
+void report( const pChr* name, LogHistogram const& hist, pBool verbose )
+{
+    std::cout << std::left << std::setw( 10 ) << name << std::right
+              << " n=" << std::setw( 9 ) << hist.Count()
+              << "  p50<=" << std::setw( 7 ) << hist.Percentile( 0.5 )
+              << "  p90<=" << std::setw( 7 ) << hist.Percentile( 0.9 )
+              << "  p99<=" << std::setw( 7 ) << hist.Percentile( 0.99 )
+              << "  p99.9<=" << std::setw( 8 ) << hist.Percentile( 0.999 )
+              << "  max=" << std::setw( 9 ) << hist.Max() << " ns\n";
+    if ( verbose ) hist.Print( std::cout, name );
+}
+
+/**
+ * --standby=1 runs a pool whose chunks are pre-built by a background thread.
+ */
+template<typename PoolT> pInt run( Options const& opt )
+{
+    TickClock clock( opt.tsc );
+    PoolT pool( opt.magazines );
+    LogHistogram constructNs;
+    LogHistogram destructNs;
+    std::atomic<pBool> stopLoad( false );
+    std::atomic<pSzt> nReady( 0 );
+
+    std::vector<std::thread> loadThreads;
+    for ( pSzt i( 0 ) ; i< opt.loadThreads ; ++i )
+    {
+        loadThreads.emplace_back( [&]( pSzt idx )
+                                  {
+                                      if ( opt.pin ) pinThread( idx );
+                                      pInt thId = static_cast<pInt>( idx );
+                                      std::vector<Payload*> held( 64 );
+                                      nReady++;
+                                      while ( !stopLoad.load( std::memory_order_relaxed ) )
+                                      {
+                                          for ( pSzt n( 0 ) ; n< held.size() ; ++n ) held[ n ] = pool.Construct( ThreadHint( thId ), thId, n );
+                                          for ( Payload* p : held ) pool.Destruct( ThreadHint( thId ), p );
+                                      }
+                                  }, opt.threads + i );
+    }
+
+    std::vector<std::thread> thVec;
+    for ( pSzt i( 0 ) ; i< opt.threads ; ++i )
+    {
+        thVec.emplace_back( [&]( pSzt idx )
+                            {
+                                if ( opt.pin ) pinThread( idx );
+                                pInt thId = static_cast<pInt>( idx );
+                                std::vector<Payload*> held( opt.live );
+                                nReady++;
+                                while ( nReady.load() < opt.threads + opt.loadThreads );
+                                for ( pSzt r( 0 ) ; r< opt.rounds ; ++r )
+                                {
+                                    for ( pSzt n( 0 ) ; n< held.size() ; ++n )
+                                    {
+                                        pSzt t0 = clock.Now();
+                                        held[ n ] = pool.Construct( ThreadHint( thId ), thId, n );
+                                        pSzt t1 = clock.Now();
+                                        constructNs.Record( clock.ToNanos( t1 - t0 ) );
+                                    }
+                                    for ( Payload* p : held )
+                                    {
+                                        pSzt t0 = clock.Now();
+                                        pool.Destruct( ThreadHint( thId ), p );
+                                        pSzt t1 = clock.Now();
+                                        destructNs.Record( clock.ToNanos( t1 - t0 ) );
+                                    }
+                                }
+                            }, i );
+    }
+    for ( std::thread& th : thVec ) th.join();
+    stopLoad.store( true );
+    for ( std::thread& th : loadThreads ) th.join();
+
+    PoolStats st = pool.Stats();
+    std::cout << "threads=" << opt.threads << " load=" << opt.loadThreads << " rounds=" << opt.rounds
+              << " live=" << opt.live << " magazines=" << opt.magazines << " standby=" << opt.standby
+              << " clock=" << ( clock.UsesTsc() ? "tsc" : "steady" ) << " pinned=" << opt.pin << "\n";
+    report( "construct", constructNs, opt.verbose );
+    report( "destruct", destructNs, opt.verbose );
+    std::cout << "chunks=" << st.chunks << " growthEvents=" << st.growthEvents << " bytesReserved=" << st.bytesReserved
+              << " standbyChunks=" << st.standbyChunks << "\n";
+
+    if ( opt.maxP999Ns && ( constructNs.Percentile( 0.999 ) > opt.maxP999Ns || destructNs.Percentile( 0.999 ) > opt.maxP999Ns ) )
+    {
+        std::cout << "p99.9 above limit of " << opt.maxP999Ns << " ns\n";
+        return( 1 );
+    }
+    return( 0 );
+}
+
+} // namespace
+
+pInt main( pInt argc, pChr** argv )
+{
+    Options opt;
+    if ( !parseOptions( argc, argv, opt ) ) return( 2 );
+    if ( opt.standby ) return( run<LockFreeObjPool<Payload, StandbyTraits>>( opt ) );
+    return( run<LockFreeObjPool<Payload>>( opt ) );
+}
@@ -11,6 +11,7 @@
 
 #include <exception>
 #include <bitset>
+#include <algorithm>
 
 #include "types.h"
 
@@ -25,7 +26,7 @@ public:
 };
 
 /**
- * Class that supports pointer tagging.
+ * Class that supports pointer tagging in the low alignment bits.
  * 
  */
 template<class T> class AddressTagger : public ITagger
@@ -50,7 +51,7 @@ public:
         {
             return( nullptr );  
         }   
-        addr |= ( tag % _maxTag );
+        addr |= ( tag & _maxTag );
         return( reinterpret_cast<T*>( addr ) );
     }
     void DumpLowBits( const T* const ptr ) const
@@ -74,4 +75,84 @@ public:
 };
 
 
+/**
+ * Pointer tagging in the 16 upper bits of a 64-bit address, which x86-64 and
+ * AArch64 leave unused for user space pointers. The tag width no longer 
+ * depends on the alignment of T.
+ */
+template<class T> class HighBitAddressTagger : public ITagger
+{
+    static_assert( sizeof( pUIntPtrT ) == 8, "high-bit tagging needs 64-bit pointers" );
+
+    static constexpr pUIntPtrT _tagShift = 48;
+    static constexpr pUIntPtrT _tagMask = ~( ( pUIntPtrT( 1 ) << _tagShift ) - 1 );
+
+public:
+    HighBitAddressTagger() = default;
+    ~HighBitAddressTagger() = default;
+
+    T* GetCleanAddr( const T* const ptr ) const
+    {
+        pUIntPtrT addr = reinterpret_cast<pUIntPtrT>( ptr );
+        addr &= ~_tagMask;
+        return( reinterpret_cast<T*>( addr ) );
+    }
+    T* TagAddr( const T* const ptr, pUIntPtrT tag ) const
+    {
+        pUIntPtrT addr = reinterpret_cast<pUIntPtrT>( ptr );
+        if ( !IsSafeForTagging( ptr ) )
+        {
+            return( nullptr );  
+        }   
+        addr |= ( tag << _tagShift );
+        return( reinterpret_cast<T*>( addr ) );
+    }
+    pUIntPtrT GetTag( const T* const ptr ) const
+    {
+        pUIntPtrT addr = reinterpret_cast<pUIntPtrT>( ptr );
+        return( addr >> _tagShift );
+    }
+
+public:
+    pBool IsSafeForTagging( const T* const ptr ) const
+    {
+        pUIntPtrT addr = reinterpret_cast<pUIntPtrT>( ptr );
+        return( !( addr & _tagMask ) );
+    }
+};
+
+/**
+ * Tagging policies for the pool traits. Each one names its tagger type and
+ * builds it for a given slot alignment.
+ */
+struct LowBitTagging
+{
+    template<class T> using Tagger = AddressTagger<T>;
+
+    template<class T> static Tagger<T> MakeTagger( pSzt slotAlign )
+    {
+        return( Tagger<T>( std::min<pSzt>( slotAlign, 32 ) - 1 ) );
+    }
+    template<class T> static constexpr pSzt TagBits( pSzt slotAlign )
+    {
+        pSzt bits( 0 );
+        for ( pSzt a( std::min<pSzt>( slotAlign, 32 ) ) ; a > 1 ; a >>= 1 ) ++bits;
+        return( bits );
+    }
+};
+
+struct HighBitTagging
+{
+    template<class T> using Tagger = HighBitAddressTagger<T>;
+
+    template<class T> static Tagger<T> MakeTagger( pSzt /*slotAlign*/ )
+    {
+        return( Tagger<T>() );
+    }
+    template<class T> static constexpr pSzt TagBits( pSzt /*slotAlign*/ )
+    {
+        return( 16 );
+    }
+};
+
 } // namespace lfmem
\ No newline at end of file
@@ -0,0 +1,99 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#include "types.h"
+
+namespace lfmem
+{
+
+/**
+ * Spin-wait hint: lets the sibling hyperthread run and saves power while
+ * spinning on a contended line.
+ */
+inline void CpuRelax()
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    __builtin_ia32_pause();
+#elif defined( __aarch64__ )
+    asm volatile( "yield" );
+#endif
+}
+
+/**
+ * Contention management of the CAS loops. A loop creates one policy object
+ * per operation and calls Pause() after every failed CAS.
+ */
+struct NoBackoff
+{
+    inline void Pause() {}
+};
+
+/**
+ * Spins MinSpins pause instructions after the first failure, twice as many
+ * after every further one, at most MaxSpins.
+ */
+template<pSzt MinSpins = 1, pSzt MaxSpins = 64> struct ExponentialBackoff
+{
+    static_assert( MinSpins > 0 && MinSpins <= MaxSpins, "invalid backoff range" );
+
+    pSzt _spins = MinSpins;
+
+    inline void Pause()
+    {
+        for ( pSzt i( 0 ) ; i< _spins ; ++i ) CpuRelax();
+        if ( _spins < MaxSpins ) _spins = std::min<pSzt>( _spins * 2, MaxSpins );
+    }
+};
+
+/**
+ * Exponential backoff with full jitter: spins a random count below the
+ * current bound, so threads that failed together do not retry together.
+ */
+template<pSzt MinSpins = 1, pSzt MaxSpins = 64> struct JitteredBackoff
+{
+    static_assert( MinSpins > 0 && MinSpins <= MaxSpins, "invalid backoff range" );
+
+    pSzt _bound = MinSpins;
+
+    inline void Pause()
+    {
+        static thread_local pUInt32 rnd = static_cast<pUInt32>( std::hash<pThreadId>()( std::this_thread::get_id() ) ) | 1;
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        pSzt spins = 1 + rnd % _bound;
+        for ( pSzt i( 0 ) ; i< spins ; ++i ) CpuRelax();
+        if ( _bound < MaxSpins ) _bound = std::min<pSzt>( _bound * 2, MaxSpins );
+    }
+};
+
+/**
+ * Backs off with Inner for the first YieldAfter failures and yields the CPU
+ * on every later one, so a thread preempted in the middle of its update can
+ * finish when threads outnumber cores.
+ */
+template<pSzt YieldAfter = 8, typename Inner = ExponentialBackoff<>> struct YieldingBackoff
+{
+    pSzt _nFailures = 0;
+    Inner _inner;
+
+    inline void Pause()
+    {
+        if ( _nFailures++ < YieldAfter ) _inner.Pause();
+        else std::this_thread::yield();
+    }
+};
+
+} // namespace lfmem
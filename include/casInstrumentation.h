@@ -0,0 +1,115 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <ostream>
+
+#include "types.h"
+#include "histogram.h"
+
+namespace lfmem
+{
+
+/**
+ * CAS loops and lock spins reported to the instrumentation policy.
+ */
+enum class CasSite : pSzt
+{
+    PoolAllocPop = 0,   // chunk free-list pop
+    PoolFreePush,       // chunk free-list push
+    ChunkListLock,      // waiting for the chunk-list lock (growth, Trim)
+    ChunkGrowthRace,    // 1 if an exhausted allocation chunk was replaced by another thread
+    StackPush,
+    StackPop,
+    QueuePush,          // position claims of LockFreeQueue
+    QueuePop,
+    Count
+};
+
+/**
+ * Default instrumentation: every hook is an empty inline function, so the
+ * instrumented loops compile to exactly the uninstrumented code.
+ */
+struct NoCasInstrumentation
+{
+    static constexpr pBool enabled = false;
+
+    struct Probe
+    {
+        inline void Retry() {}
+    };
+
+    inline Probe Begin( CasSite ) const { return( Probe() ); }
+    inline void End( CasSite, Probe const& ) {}
+};
+
+/**
+ * Records per call site a histogram of CAS retries per operation and of the
+ * nanoseconds spent between the first failed CAS and the successful one.
+ * Uncontended operations only cost the retry-histogram record.
+ */
+class CasHistogramInstrumentation
+{
+    using ClockT = std::chrono::steady_clock;
+    static constexpr pSzt _nSites = static_cast<pSzt>( CasSite::Count );
+
+    LogHistogram _retries[ _nSites ];
+    LogHistogram _spinNanos[ _nSites ];
+
+public:
+    static constexpr pBool enabled = true;
+
+    struct Probe
+    {
+        pSzt _nRetries = 0;
+        ClockT::time_point _firstFail;
+
+        inline void Retry()
+        {
+            if ( !_nRetries++ ) _firstFail = ClockT::now();
+        }
+    };
+
+    inline Probe Begin( CasSite ) const { return( Probe() ); }
+    inline void End( CasSite site, Probe const& probe )
+    {
+        pSzt s = static_cast<pSzt>( site );
+        _retries[ s ].Record( probe._nRetries );
+        if ( probe._nRetries )
+        {
+            _spinNanos[ s ].Record( std::chrono::duration_cast<std::chrono::nanoseconds>( ClockT::now() - probe._firstFail ).count() );
+        }
+    }
+
+    LogHistogram const& Retries( CasSite site ) const { return( _retries[ static_cast<pSzt>( site ) ] ); }
+    LogHistogram const& SpinNanos( CasSite site ) const { return( _spinNanos[ static_cast<pSzt>( site ) ] ); }
+
+    static const pChr* SiteName( CasSite site )
+    {
+        static const pChr* const names[ _nSites ] = { "poolAllocPop", "poolFreePush", "chunkListLock",
+                                                      "chunkGrowthRace", "stackPush", "stackPop",
+                                                      "queuePush", "queuePop" };
+        return( names[ static_cast<pSzt>( site ) ] );
+    }
+
+    void Print( std::ostream& os ) const
+    {
+        for ( pSzt s( 0 ) ; s< _nSites ; ++s )
+        {
+            if ( !_retries[ s ].Count() ) continue;
+            pStr name( SiteName( static_cast<CasSite>( s ) ) );
+            _retries[ s ].Print( os, ( name + ".retries" ).c_str() );
+            _spinNanos[ s ].Print( os, ( name + ".spinNs" ).c_str() );
+        }
+    }
+};
+
+} // namespace lfmem
@@ -0,0 +1,120 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <new>
+#include <algorithm>
+
+#include <sys/mman.h>
+
+#include "types.h"
+
+namespace lfmem
+{
+
+/**
+ * Chunk blocks from the aligned global operator new. populate is ignored,
+ * building the chunk touches its pages anyway.
+ */
+struct HeapChunkMemory
+{
+    static void* Allocate( pSzt size, pSzt align, pBool /*populate*/ )
+    {
+        return( ::operator new( size, std::align_val_t( align ) ) );
+    }
+    static void Release( void* block, pSzt /*size*/, pSzt align )
+    {
+        ::operator delete( block, std::align_val_t( align ) );
+    }
+};
+
+enum class HugePages
+{
+    None,       // regular pages
+    Advise,     // madvise( MADV_HUGEPAGE ), transparent huge pages if enabled
+    HugeTlb     // MAP_HUGETLB from the reserved pool, falls back to Advise if none is left
+};
+
+/**
+ * Chunk blocks mapped directly with mmap, optionally backed by huge pages.
+ * Blocks are aligned by over-mapping and unmapping the slack. Unless Mode is
+ * None every block is aligned to and rounded up to HugePageSize: the kernel
+ * only backs whole aligned huge pages, with MADV_HUGEPAGE as well as with 
+ * MAP_HUGETLB, and Release can always unmap the same length. Chunks smaller 
+ * than HugePageSize waste the rest of their huge page, so pair huge pages 
+ * with a growth policy whose chunks are at least that large.
+ */
+template<HugePages Mode = HugePages::Advise, pSzt HugePageSize = 2 * 1024 * 1024> struct MmapChunkMemory
+{
+    static_assert( HugePageSize && !( HugePageSize & ( HugePageSize - 1 ) ), "huge page size must be a power of two" );
+
+    static constexpr pSzt pageSize = 4096;
+    static constexpr pSzt granule = Mode == HugePages::None ? pageSize : HugePageSize;
+
+    static constexpr pSzt MappedSize( pSzt size )
+    {
+        return( ( size + granule - 1 ) / granule * granule );
+    }
+
+    static void* Allocate( pSzt size, pSzt align, pBool populate )
+    {
+        pSzt len = MappedSize( size );
+        align = std::max( align, granule );
+        pInt flags = MAP_PRIVATE | MAP_ANONYMOUS | ( populate ? MAP_POPULATE : 0 );
+        void* block = MAP_FAILED;
+        if constexpr ( Mode == HugePages::HugeTlb )
+        {
+            block = mapAligned( len, align, flags | MAP_HUGETLB, HugePageSize );
+        }
+        pBool hugeTlb = block != MAP_FAILED;
+        if ( !hugeTlb )
+        {
+            block = mapAligned( len, align, flags, pageSize );
+        }
+        if ( block == MAP_FAILED )
+        {
+            throw std::bad_alloc();
+        }
+        if ( Mode != HugePages::None && !hugeTlb )
+        {
+            madvise( block, len, MADV_HUGEPAGE );
+        }
+        return( block );
+    }
+    static void Release( void* block, pSzt size, pSzt /*align*/ )
+    {
+        munmap( block, MappedSize( size ) );
+    }
+
+private:
+    /**
+     * Mappings come aligned to mapAlign, larger alignments need slack. The 
+     * slack is mapped unpopulated and only the kept block is populated.
+     */
+    static void* mapAligned( pSzt len, pSzt align, pInt flags, pSzt mapAlign )
+    {
+        if ( align <= mapAlign )
+        {
+            return( mmap( nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0 ) );
+        }
+        pChr* raw = static_cast<pChr*>( mmap( nullptr, len + align, PROT_READ | PROT_WRITE, flags & ~MAP_POPULATE, -1, 0 ) );
+        if ( raw == MAP_FAILED ) return( MAP_FAILED );
+        pChr* block = reinterpret_cast<pChr*>( ( reinterpret_cast<pUIntPtrT>( raw ) + align - 1 ) & ~( align - 1 ) );
+        if ( block > raw ) munmap( raw, block - raw );
+        pSzt tail = ( raw + len + align ) - ( block + len );
+        if ( tail ) munmap( block + len, tail );
+#ifdef MADV_POPULATE_WRITE
+        if ( flags & MAP_POPULATE ) madvise( block, len, MADV_POPULATE_WRITE );
+#endif
+        return( block );
+    }
+};
+
+} // namespace lfmem
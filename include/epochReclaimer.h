@@ -0,0 +1,252 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+#include "types.h"
+
+namespace lfmem
+{
+
+/**
+ * Epoch-based memory reclamation.
+ *
+ * Readers of shared lock-free structures hold a Guard for the duration of an
+ * operation. Objects unlinked inside a guard are handed to Guard::Retire and
+ * reclaimed once every guard that could still see them has ended, i.e. two
+ * global epochs later.
+ *
+ * A guard claims one of a fixed set of participant slots for its lifetime,
+ * so threads need no registration or teardown. Retired objects stay in the
+ * slot's bags until a later guard on the same slot or the domain destructor
+ * reclaims them; the global epoch is only advanced every reclaimBatch
+ * retirements.
+ */
+class EpochDomain
+{
+public:
+    typedef void (*ReclaimFn)( void* ctx, void* obj );
+
+private:
+    static constexpr pUIntPtrT _activeBit = 1;
+    static constexpr pSzt _nBags = 3;
+
+    struct Retired
+    {
+        void* _obj;
+        ReclaimFn _fn;
+        void* _ctx;
+    };
+
+    struct alignas( 64 ) Slot
+    {
+        std::atomic<pBool> _owned;
+        std::atomic<pUIntPtrT> _epoch;
+        std::vector<Retired> _bags[ _nBags ];
+        pUIntPtrT _bagEpoch[ _nBags ];
+        pSzt _nSinceAdvance;
+
+        Slot() : _bagEpoch{ 0, 0, 0 }, _nSinceAdvance( 0 )
+        {
+            _owned.store( false );
+            _epoch.store( 0 );
+        }
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    pSzt _nSlots;
+    pSzt _reclaimBatch;
+    std::atomic<pUIntPtrT> _globalEpoch;
+
+    static void reclaimBag( std::vector<Retired>& bag )
+    {
+        for ( Retired const& r : bag )
+        {
+            r._fn( r._ctx, r._obj );
+        }
+        bag.clear();
+    }
+
+    Slot* acquireSlot()
+    {
+        static thread_local pSzt hint = std::hash<pThreadId>()( std::this_thread::get_id() );
+        while ( true )
+        {
+            for ( pSzt i( 0 ) ; i< _nSlots ; ++i )
+            {
+                Slot& slot = _slots[ ( hint + i ) % _nSlots ];
+                pBool owned( false );
+                if ( !slot._owned.load( std::memory_order_relaxed ) && slot._owned.compare_exchange_strong( owned, true ) )
+                {
+                    hint += i;
+                    return( &slot );
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void enter( Slot* slot )
+    {
+        pUIntPtrT epoch = _globalEpoch.load();
+        slot->_epoch.store( ( epoch << 1 ) | _activeBit );
+
+        // Bags retired at least two epochs ago cannot be seen by anyone.
+        for ( pSzt i( 0 ) ; i< _nBags ; ++i )
+        {
+            if ( !slot->_bags[ i ].empty() && slot->_bagEpoch[ i ] + 2 <= epoch )
+            {
+                reclaimBag( slot->_bags[ i ] );
+            }
+        }
+    }
+
+    void exit( Slot* slot )
+    {
+        slot->_epoch.store( 0, std::memory_order_release );
+        slot->_owned.store( false, std::memory_order_release );
+    }
+
+    /**
+     * Tagged with the global epoch at retire time rather than the announced 
+     * one: every guard that could still hold obj announced at most that 
+     * epoch, so it blocks the global epoch from moving two steps past it.
+     */
+    void retire( Slot* slot, void* obj, ReclaimFn fn, void* ctx )
+    {
+        pUIntPtrT epoch = _globalEpoch.load();
+        pSzt bagIdx = epoch % _nBags;
+        if ( slot->_bagEpoch[ bagIdx ] != epoch )
+        {
+            reclaimBag( slot->_bags[ bagIdx ] );
+            slot->_bagEpoch[ bagIdx ] = epoch;
+        }
+        slot->_bags[ bagIdx ].push_back( Retired{ obj, fn, ctx } );
+
+        if ( ++slot->_nSinceAdvance >= _reclaimBatch )
+        {
+            slot->_nSinceAdvance = 0;
+            TryAdvance();
+        }
+    }
+
+public:
+    /**
+     * A guard of a null domain is inactive and protects nothing.
+     */
+    class Guard
+    {
+        EpochDomain* _domain;
+        Slot* _slot;
+
+    public:
+        explicit Guard( EpochDomain* domain ) : _domain( domain ), _slot( domain ? domain->acquireSlot() : nullptr )
+        {
+            if ( _domain ) _domain->enter( _slot );
+        }
+        ~Guard()
+        {
+            if ( _domain ) _domain->exit( _slot );
+        }
+        Guard( const Guard& ) = delete;
+        Guard& operator=( const Guard& ) = delete;
+
+        /**
+         * obj must already be unreachable for guards that start after this call.
+         */
+        void Retire( void* obj, ReclaimFn fn, void* ctx )
+        {
+            _domain->retire( _slot, obj, fn, ctx );
+        }
+    };
+
+    explicit EpochDomain( pSzt nSlots = 128, pSzt reclaimBatch = 64 )
+        : _slots( std::make_unique<Slot[]>( std::max<pSzt>( nSlots, 1 ) ) ),
+          _nSlots( std::max<pSzt>( nSlots, 1 ) ),
+          _reclaimBatch( std::max<pSzt>( reclaimBatch, 1 ) )
+    {
+        _globalEpoch.store( 0 );
+    }
+    /**
+     * No guard may be alive any more, every retired object is reclaimed.
+     */
+    ~EpochDomain()
+    {
+        for ( pSzt i( 0 ) ; i< _nSlots ; ++i )
+        {
+            for ( pSzt b( 0 ) ; b< _nBags ; ++b )
+            {
+                reclaimBag( _slots[ i ]._bags[ b ] );
+            }
+        }
+    }
+
+    Guard Enter()
+    {
+        return( Guard( this ) );
+    }
+
+    pUIntPtrT Epoch() const
+    {
+        return( _globalEpoch.load() );
+    }
+
+    /**
+     * Advances the epoch as far as active guards allow and reclaims the bags 
+     * that became safe in every slot no guard holds right now. Must not be 
+     * called while the calling thread holds a guard of this domain.
+     */
+    void Collect()
+    {
+        TryAdvance();
+        TryAdvance();
+        pUIntPtrT epoch = _globalEpoch.load();
+        for ( pSzt i( 0 ) ; i< _nSlots ; ++i )
+        {
+            Slot& slot = _slots[ i ];
+            pBool owned( false );
+            if ( slot._owned.load( std::memory_order_relaxed ) || !slot._owned.compare_exchange_strong( owned, true ) )
+            {
+                continue;
+            }
+            for ( pSzt b( 0 ) ; b< _nBags ; ++b )
+            {
+                if ( !slot._bags[ b ].empty() && slot._bagEpoch[ b ] + 2 <= epoch )
+                {
+                    reclaimBag( slot._bags[ b ] );
+                }
+            }
+            slot._owned.store( false, std::memory_order_release );
+        }
+    }
+
+    /**
+     * Advances the global epoch if every active guard has observed the
+     * current one. Returns true on success.
+     */
+    pBool TryAdvance()
+    {
+        pUIntPtrT epoch = _globalEpoch.load();
+        for ( pSzt i( 0 ) ; i< _nSlots ; ++i )
+        {
+            pUIntPtrT slotEpoch = _slots[ i ]._epoch.load();
+            if ( ( slotEpoch & _activeBit ) && ( slotEpoch >> 1 ) != epoch )
+            {
+                return( false );
+            }
+        }
+        return( _globalEpoch.compare_exchange_strong( epoch, epoch + 1 ) );
+    }
+};
+
+} // namespace lfmem
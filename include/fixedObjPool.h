@@ -0,0 +1,198 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <new>
+
+#include "types.h"
+#include "exception.h"
+#include "objectPool.h"
+
+namespace lfmem
+{
+
+enum class Exhaustion
+{
+    ReturnNull,     // Construct returns nullptr
+    Wait,           // Construct yields until another thread frees a slot
+    HeapFallback    // Construct takes the object from operator new, Destruct returns it there
+};
+
+/**
+ * Pool of a fixed number of slots in one contiguous arena that never grows. 
+ * The free list links slots by 32-bit index and its head packs the index of 
+ * the top slot with a 32-bit version bumped on every update into one 64-bit 
+ * word, so a plain 64-bit CAS is ABA safe until the version wraps, i.e. 
+ * after 2^32 updates between a thread's load and its CAS.
+ *
+ * The capacity is N, or the constructor argument if N == 0. The arena comes 
+ * from Traits::ChunkMemory and is prefaulted.
+ */
+template<typename T, pSzt N = 0, Exhaustion OnExhausted = Exhaustion::ReturnNull, typename Traits = DefaultPoolTraits> 
+class FixedObjPool : public StaticObjectPool<FixedObjPool<T, N, OnExhausted, Traits>, T>
+{
+    friend class StaticObjectPool<FixedObjPool<T, N, OnExhausted, Traits>, T>;
+
+    using ChunkMemory = typename Traits::ChunkMemory;
+    using Instrumentation = typename Traits::Instrumentation;
+    using BackoffPolicy = typename Traits::BackoffPolicy;
+
+    static constexpr pUInt32 _nilIdx = ~pUInt32( 0 );
+    static constexpr pSzt _arenaAlign = 64;
+
+    /**
+     * The link overlays the payload of a free slot. A concurrent pop may read 
+     * the link of a slot just handed out, the versioned head CAS discards it; 
+     * that read goes through LoadSpeculative().
+     */
+    union Slot
+    {
+        std::aligned_storage_t<sizeof(T), alignof(T)> _data;
+        std::atomic<pUInt32> _next;
+    };
+
+    Slot* _slots;
+    pSzt _capacity;
+
+    alignas( 64 ) std::atomic<pUInt64> _head;
+    alignas( 64 ) StripedCounter<> _nAllocs;
+    StripedCounter<> _nFrees;
+    std::atomic<pSzt> _nFallbacks;
+
+    Instrumentation _instr;
+
+    static pUInt64 pack( pUInt64 version, pUInt32 idx ) { return( ( version << 32 ) | idx ); }
+    static pUInt32 indexOf( pUInt64 head ) { return( static_cast<pUInt32>( head ) ); }
+    static pUInt64 versionOf( pUInt64 head ) { return( head >> 32 ); }
+
+    pBool inArena( const T* const ptr ) const
+    {
+        const Slot* slot = reinterpret_cast<const Slot*>( ptr );
+        return( slot >= _slots && slot < _slots + _capacity );
+    }
+
+    T* pop()
+    {
+        auto probe = _instr.Begin( CasSite::PoolAllocPop );
+        BackoffPolicy backoff;
+        pUInt64 head = _head.load( std::memory_order_acquire );
+        while ( indexOf( head ) != _nilIdx )
+        {
+            pUInt32 next = LoadSpeculative( _slots[ indexOf( head ) ]._next );
+            if ( _head.compare_exchange_weak( head, pack( versionOf( head ) + 1, next ), std::memory_order_acquire ) )
+            {
+                _instr.End( CasSite::PoolAllocPop, probe );
+                _nAllocs.Add( 1 );
+                return( reinterpret_cast<T*>( &_slots[ indexOf( head ) ]._data ) );
+            }
+            probe.Retry();
+            backoff.Pause();
+        }
+        _instr.End( CasSite::PoolAllocPop, probe );
+        return( nullptr );
+    }
+    void push( const T* const ptr )
+    {
+        pUInt32 idx = static_cast<pUInt32>( reinterpret_cast<const Slot*>( ptr ) - _slots );
+        auto probe = _instr.Begin( CasSite::PoolFreePush );
+        BackoffPolicy backoff;
+        pUInt64 head = _head.load( std::memory_order_relaxed );
+        while ( true )
+        {
+            _slots[ idx ]._next.store( indexOf( head ), std::memory_order_relaxed );
+            if ( _head.compare_exchange_weak( head, pack( versionOf( head ) + 1, idx ), std::memory_order_release ) ) break;
+            probe.Retry();
+            backoff.Pause();
+        }
+        _instr.End( CasSite::PoolFreePush, probe );
+        _nFrees.Add( 1 );
+    }
+
+    T* allocate()
+    {
+        T* ptr = pop();
+        if ( ptr ) return( ptr );
+        if constexpr ( OnExhausted == Exhaustion::Wait )
+        {
+            while ( !( ptr = pop() ) ) std::this_thread::yield();
+        }
+        else if constexpr ( OnExhausted == Exhaustion::HeapFallback )
+        {
+            ptr = static_cast<T*>( ::operator new( sizeof(T), std::align_val_t( alignof(T) ) ) );
+            _nFallbacks.fetch_add( 1, std::memory_order_relaxed );
+        }
+        return( ptr );
+    }
+    T* allocate( ThreadHint /*hint*/ )
+    {
+        return( allocate() );
+    }
+    void deallocate( const T* const ptr ) noexcept
+    {
+        if constexpr ( OnExhausted == Exhaustion::HeapFallback )
+        {
+            if ( !inArena( ptr ) )
+            {
+                ::operator delete( const_cast<T*>( ptr ), std::align_val_t( alignof(T) ) );
+                return;
+            }
+        }
+        push( ptr );
+    }
+    void deallocate( ThreadHint /*hint*/, const T* const ptr ) noexcept
+    {
+        deallocate( ptr );
+    }
+
+public:
+    explicit FixedObjPool( pSzt capacity = N )
+        : _capacity( N ? N : capacity )
+    {
+        if ( !_capacity || _capacity >= _nilIdx )
+        {
+            throw LFException( "FixedObjPool: capacity must be in [1, 2^32 - 1)" );
+        }
+        _slots = static_cast<Slot*>( ChunkMemory::Allocate( _capacity * sizeof( Slot ), _arenaAlign, true ) );
+        for ( pSzt i( 0 ) ; i< _capacity ; ++i )
+        {
+            _slots[ i ]._next.store( i + 1 < _capacity ? static_cast<pUInt32>( i + 1 ) : _nilIdx, std::memory_order_relaxed );
+        }
+        _head.store( pack( 0, 0 ) );
+        _nFallbacks.store( 0 );
+    }
+    ~FixedObjPool()
+    {
+        ChunkMemory::Release( _slots, _capacity * sizeof( Slot ), _arenaAlign );
+    }
+    FixedObjPool( const FixedObjPool& ) = delete;
+    FixedObjPool& operator=( const FixedObjPool& ) = delete;
+
+    pSzt Capacity() const { return( _capacity ); }
+
+    /**
+     * Free slots of the arena, a snapshot under concurrent use.
+     */
+    pSzt Size() const
+    {
+        pSzt nLive = _nAllocs.Load() - _nFrees.Load();
+        return( nLive < _capacity ? _capacity - nLive : 0 );
+    }
+    /**
+     * Objects taken from operator new because the arena was exhausted.
+     */
+    pSzt FallbackCount() const { return( _nFallbacks.load() ); }
+
+    pBool Owns( const T* const ptr ) const { return( inArena( ptr ) ); }
+
+    Instrumentation const& GetInstrumentation() const { return( _instr ); }
+};
+
+} // namespace lfmem
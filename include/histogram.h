@@ -0,0 +1,122 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <ostream>
+
+#include "types.h"
+
+namespace lfmem
+{
+
+/**
+ * Concurrent histogram with power-of-two buckets: bucket 0 holds the value 0,
+ * bucket b > 0 the values in [2^(b-1), 2^b). Recording is a handful of
+ * relaxed atomic adds, readers get a snapshot that may lag in-flight records.
+ */
+class LogHistogram
+{
+public:
+    static constexpr pSzt nBuckets = 65;
+
+private:
+    std::atomic<pSzt> _buckets[ nBuckets ];
+    std::atomic<pSzt> _count;
+    std::atomic<pSzt> _sum;
+    std::atomic<pSzt> _max;
+
+public:
+    LogHistogram()
+    {
+        Reset();
+    }
+    LogHistogram( const LogHistogram& ) = delete;
+    LogHistogram& operator=( const LogHistogram& ) = delete;
+
+    static constexpr pSzt BucketOf( pSzt value )
+    {
+        pSzt b( 0 );
+        while ( value )
+        {
+            ++b;
+            value >>= 1;
+        }
+        return( b );
+    }
+    /**
+     * Largest value falling into bucket b.
+     */
+    static constexpr pSzt BucketUpperBound( pSzt b )
+    {
+        return( b >= 64 ? std::numeric_limits<pSzt>::max() : ( pSzt( 1 ) << b ) - 1 );
+    }
+
+    inline void Record( pSzt value )
+    {
+        _buckets[ BucketOf( value ) ].fetch_add( 1, std::memory_order_relaxed );
+        _count.fetch_add( 1, std::memory_order_relaxed );
+        _sum.fetch_add( value, std::memory_order_relaxed );
+        pSzt cMax = _max.load( std::memory_order_relaxed );
+        while ( value > cMax && !_max.compare_exchange_weak( cMax, value, std::memory_order_relaxed ) );
+    }
+
+    void Reset()
+    {
+        for ( std::atomic<pSzt>& b : _buckets ) b.store( 0, std::memory_order_relaxed );
+        _count.store( 0, std::memory_order_relaxed );
+        _sum.store( 0, std::memory_order_relaxed );
+        _max.store( 0, std::memory_order_relaxed );
+    }
+
+    pSzt Count() const { return( _count.load( std::memory_order_relaxed ) ); }
+    pSzt Sum() const { return( _sum.load( std::memory_order_relaxed ) ); }
+    pSzt Max() const { return( _max.load( std::memory_order_relaxed ) ); }
+    pSzt BucketCount( pSzt b ) const { return( _buckets[ b ].load( std::memory_order_relaxed ) ); }
+
+    pDbl Mean() const
+    {
+        pSzt count = Count();
+        return( count ? static_cast<pDbl>( Sum() ) / count : 0.0 );
+    }
+
+    /**
+     * Upper bound of the bucket holding the q-quantile, q in [0, 1].
+     */
+    pSzt Percentile( pDbl q ) const
+    {
+        pSzt count = Count();
+        if ( !count ) return( 0 );
+        pSzt rank = static_cast<pSzt>( q * ( count - 1 ) ) + 1;
+        pSzt seen( 0 );
+        for ( pSzt b( 0 ) ; b< nBuckets ; ++b )
+        {
+            seen += BucketCount( b );
+            if ( seen >= rank ) return( std::min( BucketUpperBound( b ), Max() ) );
+        }
+        return( Max() );
+    }
+
+    /**
+     * One line per non-empty bucket: "<name> <= upperBound: count".
+     */
+    void Print( std::ostream& os, const pChr* const name ) const
+    {
+        os << name << " count=" << Count() << " mean=" << Mean() << " max=" << Max() << "\n";
+        for ( pSzt b( 0 ) ; b< nBuckets ; ++b )
+        {
+            pSzt n = BucketCount( b );
+            if ( n ) os << "  " << name << " <= " << BucketUpperBound( b ) << ": " << n << "\n";
+        }
+    }
+};
+
+} // namespace lfmem
@@ -0,0 +1,175 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <atomic>
+
+#include "types.h"
+#include "exception.h"
+#include "poolTraits.h"
+
+namespace lfmem
+{
+
+/**
+ * Bounded MPMC FIFO of pointers on a power-of-two ring (Vyukov). Every slot
+ * carries a sequence number telling which lap of the enqueue or dequeue
+ * position may use it next, so producers and consumers only contend on
+ * their own position counter and nothing is allocated per element. Push
+ * fails on a full queue, Pop returns nullptr on an empty one.
+ */
+template<typename T, typename Traits = DefaultPoolTraits> class LockFreeQueue
+{
+    using Instrumentation = typename Traits::Instrumentation;
+    using BackoffPolicy = typename Traits::BackoffPolicy;
+
+    struct Slot
+    {
+        std::atomic<pSzt> _seq;
+        T* _data;
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    pSzt _mask;
+
+    alignas( 64 ) std::atomic<pSzt> _enqPos;
+    alignas( 64 ) std::atomic<pSzt> _deqPos;
+
+    Instrumentation _instr;
+
+    /**
+     * Claims up to n consecutive positions whose slots are ready for this
+     * lap, i.e. hold seq == pos + i + lapOffset, with one CAS on posAtom.
+     * Returns the number claimed and their first position in pos.
+     */
+    pSzt claim( std::atomic<pSzt>& posAtom, pSzt n, pSzt lapOffset, CasSite site, pSzt& pos )
+    {
+        auto probe = _instr.Begin( site );
+        BackoffPolicy backoff;
+        pos = posAtom.load( std::memory_order_relaxed );
+        while ( true )
+        {
+            pSzt nReady( 0 );
+            while ( nReady < n && _slots[ ( pos + nReady ) & _mask ]._seq.load( std::memory_order_acquire ) == pos + nReady + lapOffset )
+            {
+                ++nReady;
+            }
+            if ( !nReady )
+            {
+                pSzt seq = _slots[ pos & _mask ]._seq.load( std::memory_order_acquire );
+                pSzt cPos = posAtom.load( std::memory_order_relaxed );
+                // Slot still held by the previous lap: the queue is full or empty.
+                if ( cPos == pos && static_cast<std::make_signed_t<pSzt>>( seq - ( pos + lapOffset ) ) < 0 ) break;
+                pos = cPos;
+                probe.Retry();
+                backoff.Pause();
+                continue;
+            }
+            if ( posAtom.compare_exchange_weak( pos, pos + nReady, std::memory_order_relaxed ) )
+            {
+                _instr.End( site, probe );
+                return( nReady );
+            }
+            probe.Retry();
+            backoff.Pause();
+        }
+        _instr.End( site, probe );
+        return( 0 );
+    }
+
+public:
+    /**
+     * capacity is rounded up to a power of two, at least 2.
+     */
+    explicit LockFreeQueue( pSzt capacity = 1024 )
+    {
+        pSzt cap = pmath::CeilPow2<pSzt>( std::max<pSzt>( capacity, 2 ) );
+        _slots = std::make_unique<Slot[]>( cap );
+        _mask = cap - 1;
+        for ( pSzt i( 0 ) ; i< cap ; ++i )
+        {
+            _slots[ i ]._seq.store( i, std::memory_order_relaxed );
+            _slots[ i ]._data = nullptr;
+        }
+        _enqPos.store( 0 );
+        _deqPos.store( 0 );
+    }
+    ~LockFreeQueue() = default;
+    LockFreeQueue( const LockFreeQueue& ) = delete;
+    LockFreeQueue& operator=( const LockFreeQueue& ) = delete;
+
+    pSzt Capacity() const { return( _mask + 1 ); }
+
+    [[nodiscard]] pBool Push( T* data )
+    {
+        return( PushBatch( &data, 1 ) == 1 );
+    }
+    [[nodiscard]] T* Pop()
+    {
+        T* data = nullptr;
+        return( PopBatch( &data, 1 ) ? data : nullptr );
+    }
+
+    /**
+     * Enqueues up to n pointers in order, claiming all of them with one CAS.
+     * Returns how many were enqueued, fewer than n if the queue filled up.
+     */
+    pSzt PushBatch( T* const* data, pSzt n )
+    {
+        pSzt nDone( 0 );
+        while ( nDone < n )
+        {
+            pSzt pos( 0 );
+            pSzt nClaimed = claim( _enqPos, n - nDone, 0, CasSite::QueuePush, pos );
+            if ( !nClaimed ) break;
+            for ( pSzt i( 0 ) ; i< nClaimed ; ++i )
+            {
+                Slot& slot = _slots[ ( pos + i ) & _mask ];
+                slot._data = data[ nDone + i ];
+                slot._seq.store( pos + i + 1, std::memory_order_release );
+            }
+            nDone += nClaimed;
+        }
+        return( nDone );
+    }
+    /**
+     * Dequeues up to n pointers into out in FIFO order. Returns how many.
+     */
+    pSzt PopBatch( T** out, pSzt n )
+    {
+        pSzt nDone( 0 );
+        while ( nDone < n )
+        {
+            pSzt pos( 0 );
+            pSzt nClaimed = claim( _deqPos, n - nDone, 1, CasSite::QueuePop, pos );
+            if ( !nClaimed ) break;
+            for ( pSzt i( 0 ) ; i< nClaimed ; ++i )
+            {
+                Slot& slot = _slots[ ( pos + i ) & _mask ];
+                out[ nDone + i ] = slot._data;
+                slot._seq.store( pos + i + _mask + 1, std::memory_order_release );
+            }
+            nDone += nClaimed;
+        }
+        return( nDone );
+    }
+
+    /**
+     * A snapshot: concurrent pushes and pops may change it right away.
+     */
+    pBool IsEmpty() const
+    {
+        return( _deqPos.load() >= _enqPos.load() );
+    }
+
+    Instrumentation const& GetInstrumentation() const { return( _instr ); }
+};
+
+} // namespace lfmem
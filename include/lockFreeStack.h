@@ -10,13 +10,31 @@
 #pragma once
 
 #include <atomic>
+#include <algorithm>
 
 #include "types.h"
+#include "exception.h"
+#include "objectPool.h"
+#include "epochReclaimer.h"
 
 namespace lfmem
 {
 
-template<typename T> class LockFreeStack 
+/**
+ * Treiber stack whose nodes come from an internal LockFreeObjPool, so Push 
+ * and Pop never touch the heap once the node pool is warm. Popped nodes are 
+ * retired through an EpochDomain and only return to the node pool once no 
+ * concurrent Pop can still read their _next. The head also carries a tag 
+ * from Traits::TagPolicy that is bumped on every update.
+ *
+ * A Push or Pop whose head CAS fails tries to meet a partner in a small 
+ * elimination array before retrying: a pusher offers its node in a random 
+ * exchange slot and waits a few spins for a popper to take it, so colliding 
+ * pairs complete without touching the head. The slot range shrinks when 
+ * offers time out and grows when slots collide, the wait doubles on every 
+ * exchange and halves on every timeout.
+ */
+template<typename T, typename Traits = DefaultPoolTraits> class LockFreeStack 
 {
 
     struct Item
@@ -24,21 +42,95 @@ template<typename T> class LockFreeStack
         T* _data;
         std::atomic<Item*> _next;
 
-        Item( T* data ) 
+        explicit Item( T* data ) 
             : _data( data )
         {
             _next.store( nullptr );
         }
     };
 
-    static constexpr pSzt _itemAlign = 64;
-    typedef std::aligned_storage_t<sizeof(Item), _itemAlign> ItemStorage;
+    using ItemPoolT = LockFreeObjPool<Item, Traits>;
+    using TagPolicy = typename Traits::TagPolicy;
+    using TaggerT = typename TagPolicy::template Tagger<Item>;
+    using Instrumentation = typename Traits::Instrumentation;
+    using BackoffPolicy = typename Traits::BackoffPolicy;
+
+    static constexpr pSzt _maxEliminationSlots = 16;
+    static constexpr pSzt _minEliminationSpins = 16;
+    static constexpr pSzt _maxEliminationSpins = 1024;
+
+    /**
+     * Holds nullptr, a node offered by a pusher, or takenMark() once a popper 
+     * took the offer; the pusher then clears it.
+     */
+    struct alignas( 64 ) ExchangeSlot
+    {
+        std::atomic<Item*> _offer;
+    };
+
+    ItemPoolT _itemPool;
+    EpochDomain _epochDomain;
+    TaggerT _headTagger;
 
     std::atomic<Item*> _head;
     std::atomic<pInt> _popCount;
 
+    Instrumentation _instr;
+
+    std::unique_ptr<ExchangeSlot[]> _exchangeSlots;
+    pSzt _nExchangeSlots;
+    std::atomic<pSzt> _exchangeRange;
+    std::atomic<pSzt> _exchangeSpins;
+    StripedCounter<> _nEliminated;
+
+    static void reclaimItem( void* stack, void* item )
+    {
+        static_cast<LockFreeStack*>( stack )->_itemPool.Destruct( static_cast<Item*>( item ) );
+    }
+
+    inline Item* nextHead( Item* oldHead, Item* newTop ) const
+    {
+        return( _headTagger.TagAddr( newTop, _headTagger.GetTag( oldHead ) + 1 ) );
+    }
+
+    static Item* takenMark() { return( reinterpret_cast<Item*>( alignof( Item ) ) ); }
+
+    ExchangeSlot& pickSlot()
+    {
+        static thread_local pUInt32 rnd = static_cast<pUInt32>( std::hash<pThreadId>()( std::this_thread::get_id() ) ) | 1;
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        return( _exchangeSlots[ rnd % _exchangeRange.load( std::memory_order_relaxed ) ] );
+    }
+    void onExchanged()
+    {
+        _nEliminated.Add( 1 );
+        pSzt spins = _exchangeSpins.load( std::memory_order_relaxed );
+        if ( spins < _maxEliminationSpins ) _exchangeSpins.store( spins * 2, std::memory_order_relaxed );
+    }
+    void onTimeout()
+    {
+        pSzt spins = _exchangeSpins.load( std::memory_order_relaxed );
+        if ( spins > _minEliminationSpins ) _exchangeSpins.store( spins / 2, std::memory_order_relaxed );
+        pSzt range = _exchangeRange.load( std::memory_order_relaxed );
+        if ( range > 1 ) _exchangeRange.store( range - 1, std::memory_order_relaxed );
+    }
+    void onCollision()
+    {
+        pSzt range = _exchangeRange.load( std::memory_order_relaxed );
+        if ( range < _nExchangeSlots ) _exchangeRange.store( range + 1, std::memory_order_relaxed );
+    }
+
+    pBool eliminatePush( Item* item );
+    Item* eliminatePop();
+
 public: 
-    LockFreeStack();
+    /**
+     * eliminationSlots == 0 disables the elimination array, the default 
+     * sizes it to half the hardware threads, at most 16.
+     */
+    explicit LockFreeStack( pSzt eliminationSlots = std::min<pSzt>( std::max<pSzt>( std::thread::hardware_concurrency() / 2, 1 ), _maxEliminationSlots ) );
     ~LockFreeStack() = default;
 
     void Push( T* dataPtr );
@@ -46,51 +138,150 @@ public:
     [[nodiscard]] T* Pop();
 
     pBool IsEmpty() const;
+
+    /**
+     * Push/Pop pairs completed through the elimination array.
+     */
+    pSzt EliminatedCount() const { return( _nEliminated.Load() ); }
+
+    Instrumentation const& GetInstrumentation() const { return( _instr ); }
 };
 
-template<typename T> LockFreeStack<T>::LockFreeStack() 
+template<typename T, typename Traits> LockFreeStack<T, Traits>::LockFreeStack( pSzt eliminationSlots ) 
+    : _headTagger( TagPolicy::template MakeTagger<Item>( ItemPoolT::slotAlign ) ), _nExchangeSlots( std::min( eliminationSlots, _maxEliminationSlots ) )
 {
     _head.store( nullptr );
     _popCount.store( 0 );
+    if ( _nExchangeSlots )
+    {
+        _exchangeSlots = std::make_unique<ExchangeSlot[]>( _nExchangeSlots );
+        for ( pSzt i( 0 ) ; i< _nExchangeSlots ; ++i ) _exchangeSlots[ i ]._offer.store( nullptr );
+    }
+    _exchangeRange.store( std::max<pSzt>( _nExchangeSlots / 2, 1 ) );
+    _exchangeSpins.store( _minEliminationSpins * 4 );
 }
 
+/**
+ * Offers item in a random slot. True if a popper took it, the item then 
+ * belongs to the popper.
+ */
+template<typename T, typename Traits> pBool LockFreeStack<T, Traits>::eliminatePush( Item* item )
+{
+    ExchangeSlot& slot = pickSlot();
+    Item* empty = nullptr;
+    if ( !slot._offer.compare_exchange_strong( empty, item, std::memory_order_acq_rel ) )
+    {
+        onCollision();
+        return( false );
+    }
+    pSzt spins = _exchangeSpins.load( std::memory_order_relaxed );
+    for ( pSzt i( 0 ) ; i< spins ; ++i )
+    {
+        if ( slot._offer.load( std::memory_order_acquire ) == takenMark() ) break;
+        CpuRelax();
+    }
+    Item* offered = item;
+    if ( slot._offer.compare_exchange_strong( offered, nullptr, std::memory_order_acq_rel ) )
+    {
+        onTimeout();
+        return( false );
+    }
+    slot._offer.store( nullptr, std::memory_order_release );
+    onExchanged();
+    return( true );
+}
 
-template<typename T> pBool LockFreeStack<T>::IsEmpty() const
+/**
+ * Takes a node offered by a concurrent pusher, nullptr if none shows up.
+ */
+template<typename T, typename Traits> typename LockFreeStack<T, Traits>::Item* LockFreeStack<T, Traits>::eliminatePop()
 {
-    return( _head.load() == nullptr );
+    ExchangeSlot& slot = pickSlot();
+    pSzt spins = _exchangeSpins.load( std::memory_order_relaxed );
+    for ( pSzt i( 0 ) ; i< spins ; ++i )
+    {
+        Item* offer = slot._offer.load( std::memory_order_acquire );
+        if ( offer && offer != takenMark() )
+        {
+            if ( slot._offer.compare_exchange_strong( offer, takenMark(), std::memory_order_acq_rel ) ) return( offer );
+            onCollision();
+            return( nullptr );
+        }
+        CpuRelax();
+    }
+    onTimeout();
+    return( nullptr );
+}
+
+
+template<typename T, typename Traits> pBool LockFreeStack<T, Traits>::IsEmpty() const
+{
+    return( _headTagger.GetCleanAddr( _head.load() ) == nullptr );
 }
 
-template<typename T> void LockFreeStack<T>::Push( T* data )
+template<typename T, typename Traits> void LockFreeStack<T, Traits>::Push( T* data )
 {
-    Item* dItem = new Item( data );
+    Item* dItem = _itemPool.Construct( data );
+    if ( !dItem )
+    {
+        throw LFException( "LockFreeStack: node pool exhausted" );
+    }
+    auto probe = _instr.Begin( CasSite::StackPush );
+    BackoffPolicy backoff;
     Item* currHead = _head.load();
-    do
+    while ( true )
     {
-        dItem->_next.store( currHead );
+        dItem->_next.store( _headTagger.GetCleanAddr( currHead ) );
+        if ( _head.compare_exchange_weak( currHead, nextHead( currHead, dItem ) ) ) break;
+        probe.Retry();
+        if ( _nExchangeSlots && eliminatePush( dItem ) ) break;
+        backoff.Pause();
+        currHead = _head.load();
     }
-    while ( !_head.compare_exchange_weak( currHead, dItem ) );
+    _instr.End( CasSite::StackPush, probe );
 }
 
-template<typename T> T* LockFreeStack<T>::Pop() 
+template<typename T, typename Traits> T* LockFreeStack<T, Traits>::Pop() 
 {
+    EpochDomain::Guard guard( &_epochDomain );
+    auto probe = _instr.Begin( CasSite::StackPop );
+    BackoffPolicy backoff;
     Item* rItem = _head.load();
+    Item* cItem = nullptr;
     Item* nextItem = nullptr;
     T* data = nullptr;
-    do 
+    while ( true )
     {
-        if ( !rItem )
+        cItem = _headTagger.GetCleanAddr( rItem );
+        if ( !cItem )
         {
+            _instr.End( CasSite::StackPop, probe );
             return( nullptr );
         }
         
-        nextItem = rItem->_next.load();
-    }  
-    while ( !_head.compare_exchange_weak( rItem, nextItem ) );
-    if ( rItem )
-    {
-        data = rItem->_data;
-        delete rItem;
+        nextItem = cItem->_next.load();
+        if ( _head.compare_exchange_weak( rItem, nextHead( rItem, nextItem ) ) ) break;
+        probe.Retry();
+        if ( _nExchangeSlots )
+        {
+            if ( Item* xItem = eliminatePop() )
+            {
+                // The node never was in the stack, no Pop can be reading it.
+                _instr.End( CasSite::StackPop, probe );
+                _popCount.fetch_add( 1, std::memory_order_relaxed );
+                data = xItem->_data;
+                _itemPool.Destruct( xItem );
+                return( data );
+            }
+        }
+        backoff.Pause();
+        rItem = _head.load();
     }
+    _instr.End( CasSite::StackPop, probe );
+    _popCount.fetch_add( 1, std::memory_order_relaxed );
+
+    data = cItem->_data;
+    guard.Retire( cItem, &reclaimItem, this );
     return( data );
 }
 
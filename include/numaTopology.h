@@ -0,0 +1,133 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <fstream>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "types.h"
+
+namespace lfmem
+{
+
+/**
+ * CPU to NUMA node map read once from /sys/devices/system/node. Nodes are 
+ * indexed densely in the order of the online node list, so node numbering 
+ * with gaps (e.g. nodes 0 and 2) yields indices 0 and 1; NodeId() maps an 
+ * index back to the kernel's node number. Machines without that directory, 
+ * or with a single node, report one node holding every CPU.
+ */
+class NumaTopology
+{
+    std::vector<pSzt> _cpuToNode;
+    std::vector<pSztVec> _nodeCpus;
+    pSztVec _nodeIds;
+
+    /**
+     * Parses a kernel range list such as "0-3,8-11", as used for CPU and 
+     * node lists.
+     */
+    static pSztVec parseCpuList( pStr const& list )
+    {
+        pSztVec cpus;
+        std::stringstream ss( list );
+        pStr range;
+        while ( std::getline( ss, range, ',' ) )
+        {
+            if ( range.empty() || range[ 0 ] == '\n' ) continue;
+            pSzt dash = range.find( '-' );
+            pSzt first = std::stoul( range.substr( 0, dash ) );
+            pSzt last = dash == pStr::npos ? first : std::stoul( range.substr( dash + 1 ) );
+            for ( pSzt cpu( first ) ; cpu<= last ; ++cpu ) cpus.push_back( cpu );
+        }
+        return( cpus );
+    }
+
+    static pBool readLine( pStr const& path, pStr& line )
+    {
+        std::ifstream in( path );
+        return( in && std::getline( in, line ) );
+    }
+
+    NumaTopology()
+    {
+        const pStr nodeDir( "/sys/devices/system/node/" );
+        pStr online;
+        if ( readLine( nodeDir + "online", online ) )
+        {
+            for ( pSzt nodeId : parseCpuList( online ) )
+            {
+                pStr list;
+                if ( !readLine( nodeDir + "node" + std::to_string( nodeId ) + "/cpulist", list ) ) continue;
+                pSztVec cpus = parseCpuList( list );
+                // Memory-only nodes have no CPUs to place threads on.
+                if ( cpus.empty() ) continue;
+                for ( pSzt cpu : cpus )
+                {
+                    if ( cpu >= _cpuToNode.size() ) _cpuToNode.resize( cpu + 1, 0 );
+                    _cpuToNode[ cpu ] = _nodeCpus.size();
+                }
+                _nodeCpus.push_back( std::move( cpus ) );
+                _nodeIds.push_back( nodeId );
+            }
+        }
+        if ( _nodeCpus.empty() )
+        {
+            pSzt nCpus = std::max<pSzt>( std::thread::hardware_concurrency(), 1 );
+            _nodeCpus.emplace_back();
+            for ( pSzt cpu( 0 ) ; cpu< nCpus ; ++cpu ) _nodeCpus[ 0 ].push_back( cpu );
+            _cpuToNode.assign( nCpus, 0 );
+            _nodeIds.assign( 1, 0 );
+        }
+    }
+
+public:
+    static NumaTopology const& System()
+    {
+        static const NumaTopology topology;
+        return( topology );
+    }
+
+    pSzt NodeCount() const { return( _nodeCpus.size() ); }
+    pSzt CpuCount() const { return( _cpuToNode.size() ); }
+    pSztVec const& NodeCpus( pSzt node ) const { return( _nodeCpus[ node ] ); }
+    pSzt NodeId( pSzt node ) const { return( _nodeIds[ node ] ); }
+
+    pSzt NodeOfCpu( pSzt cpu ) const
+    {
+        return( cpu < _cpuToNode.size() ? _cpuToNode[ cpu ] : 0 );
+    }
+
+    /**
+     * CPU the calling thread runs on right now, 0 if unknown.
+     */
+    static pSzt CurrentCpu()
+    {
+        pInt cpu = sched_getcpu();
+        return( cpu < 0 ? 0 : static_cast<pSzt>( cpu ) );
+    }
+
+    /**
+     * Restricts the calling thread to the CPUs of node. Returns false if the
+     * affinity could not be set.
+     */
+    pBool BindCurrentThread( pSzt node ) const
+    {
+        cpu_set_t cpus;
+        CPU_ZERO( &cpus );
+        for ( pSzt cpu : _nodeCpus[ node ] ) CPU_SET( cpu, &cpus );
+        return( !pthread_setaffinity_np( pthread_self(), sizeof( cpus ), &cpus ) );
+    }
+};
+
+} // namespace lfmem
@@ -10,92 +10,329 @@
 #pragma once
 
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <array>
+#include <condition_variable>
+#include <type_traits>
 
 #include "types.h"
 #include "addrTagger.h"
+#include "poolTraits.h"
+#include "epochReclaimer.h"
+#include "stripedCounter.h"
 
 namespace lfmem
 {
 
-template<typename T> class BaseObjectPool
+/**
+ * Identifies the calling thread to a pool, it selects the magazine and the 
+ * allocation stripe. Kept apart from the constructor arguments of T.
+ */
+struct ThreadHint
 {
+    pSzt _id;
+
+    template<typename I, typename = std::enable_if_t<std::is_integral_v<I>>> 
+    constexpr explicit ThreadHint( I id ) : _id( static_cast<pSzt>( id ) ) {}
+};
+
+template<typename Pool> class ObjectPoolAdapter;
+
+/**
+ * Static pool interface. Derived provides the slot hooks allocate(), 
+ * allocate( ThreadHint ), deallocate( ptr ) and deallocate( ThreadHint, ptr ); 
+ * the calls are resolved at compile time, so the whole fast path inlines 
+ * into the caller. Construct emplaces T from its arguments only, Destruct 
+ * runs ~T unless T is trivially destructible.
+ */
+template<typename Derived, typename T> class StaticObjectPool
+{
+    template<typename Pool> friend class ObjectPoolAdapter;
+
+    Derived& derived() { return( static_cast<Derived&>( *this ) ); }
+
+    template<typename... ArgsType> T* emplace( T* ptr, ArgsType&&... args )
+    {
+        if ( !ptr ) return( nullptr );
+        if constexpr ( std::is_nothrow_constructible_v<T, ArgsType...> )
+        {
+            return( new ( ptr ) T( std::forward<ArgsType>( args )... ) );
+        }
+        else
+        {
+            try
+            {
+                return( new ( ptr ) T( std::forward<ArgsType>( args )... ) );
+            }
+            catch ( ... )
+            {
+                derived().deallocate( ptr );
+                throw;
+            }
+        }
+    }
+
+    static T* allocateFrom( Derived& pool, ThreadHint hint ) { return( pool.allocate( hint ) ); }
+    static T* allocateFrom( Derived& pool ) { return( pool.allocate() ); }
+    static void deallocateTo( Derived& pool, ThreadHint hint, const T* const ptr ) { pool.deallocate( hint, ptr ); }
+    static void deallocateTo( Derived& pool, const T* const ptr ) { pool.deallocate( ptr ); }
+
+protected:
+    static void destroy( const T* const ptr ) noexcept
+    {
+        if constexpr ( !std::is_trivially_destructible_v<T> ) ptr->~T();
+    }
+
+public:
+    using ValueType = T;
+
+    template<typename... ArgsType> T* Construct( ThreadHint hint, ArgsType&&... args )
+    {
+        return( emplace( derived().allocate( hint ), std::forward<ArgsType>( args )... ) );
+    }
+    template<typename... ArgsType> T* Construct( ArgsType&&... args )
+    {
+        return( emplace( derived().allocate(), std::forward<ArgsType>( args )... ) );
+    }
+    void Destruct( const T* const ptr ) noexcept
+    {
+        if ( !ptr ) return;
+        destroy( ptr );
+        derived().deallocate( ptr );
+    }
+    void Destruct( ThreadHint hint, const T* const ptr ) noexcept
+    {
+        if ( !ptr ) return;
+        destroy( ptr );
+        derived().deallocate( hint, ptr );
+    }
+};
+
+/**
+ * Type-erased pool interface, the slot hooks are virtual. Only for code that 
+ * must hold pools of different types behind one pointer, see 
+ * ObjectPoolAdapter; the pools themselves do not derive from it.
+ */
+template<typename T> class BaseObjectPool : public StaticObjectPool<BaseObjectPool<T>, T>
+{
+    friend class StaticObjectPool<BaseObjectPool<T>, T>;
+
 public:
     virtual ~BaseObjectPool() {}
 
-    virtual void Destruct( const T* const ptr ) noexcept = 0;
+protected:
+    virtual T* allocate( ThreadHint hint ) = 0;
+    virtual T* allocate() = 0;
+    virtual void deallocate( ThreadHint hint, const T* const ptr ) noexcept = 0;
+    virtual void deallocate( const T* const ptr ) noexcept = 0;
+};
+
+/**
+ * BaseObjectPool over a pool with the static interface, which it references 
+ * but does not own.
+ */
+template<typename Pool> class ObjectPoolAdapter : public BaseObjectPool<typename Pool::ValueType>
+{
+    using T = typename Pool::ValueType;
+    using StaticT = StaticObjectPool<Pool, T>;
+
+    Pool& _pool;
+
+public:
+    explicit ObjectPoolAdapter( Pool& pool ) : _pool( pool ) {}
 
 protected:
-    virtual T* allocate( pInt thId ) = 0;
-    virtual void deallocate( const T* const ptr ) = 0;
+    T* allocate( ThreadHint hint ) override { return( StaticT::allocateFrom( _pool, hint ) ); }
+    T* allocate() override { return( StaticT::allocateFrom( _pool ) ); }
+    void deallocate( ThreadHint hint, const T* const ptr ) noexcept override { StaticT::deallocateTo( _pool, hint, ptr ); }
+    void deallocate( const T* const ptr ) noexcept override { StaticT::deallocateTo( _pool, ptr ); }
 };
 
-template<typename T> struct PoolItem
+/**
+ * Loads a free-list link that may overlay an object another thread is 
+ * constructing at the same time: an atomic load against the plain stores of 
+ * the constructor, a data race by the letter of the memory model. The value 
+ * is only used once a versioned head CAS has confirmed the slot was still 
+ * free, so a stale or torn read is discarded. The load is hidden from 
+ * ThreadSanitizer, which would otherwise report this known race on every 
+ * contended pop of an overlaid free list.
+ */
+template<typename V> LF_NO_SANITIZE_THREAD inline V LoadSpeculative( const std::atomic<V>& link )
 {
-    static constexpr pSzt storageSize = 64;
+#if defined( __GNUC__ )
+    static_assert( sizeof( std::atomic<V> ) == sizeof( V ), "atomic with a lock or padding" );
+    return( __atomic_load_n( reinterpret_cast<const V*>( &link ), __ATOMIC_SEQ_CST ) );
+#else
+    return( link.load() );
+#endif
+}
+
+template<typename T, typename Layout = SplitItemLayout<>, pBool Compact = Layout::compact> struct PoolItem;
+
+/**
+ * Payload followed by its own free-list link. While the slot is handed out 
+ * the link word holds the reference count of PoolSharedPtr instead; stale 
+ * reads of it by concurrent pops are discarded like those of a compact slot.
+ */
+template<typename T, typename Layout> struct PoolItem<T, Layout, false>
+{
+    static constexpr pSzt storageSize = Layout::template SlotAlign<T>();
+    static constexpr pBool hasRefCount = true;
 
     std::aligned_storage_t<sizeof(T), storageSize> _data;
-    std::atomic<PoolItem*> _next;
-    std::atomic<pUIntPtrT> _abaCount;
-    PoolItem() { _next.store( nullptr ); _next = nullptr; _abaCount = 0; }
-    inline [[nodiscard]] pUIntPtrT GetAbaCount() const 
+    union
     {
-        return( _abaCount );
-    }
-    inline void SetAbaCount( pUIntPtrT abaCount )
+        std::atomic<PoolItem*> _next;
+        std::atomic<pSzt> _refs;
+    };
+    PoolItem() { _next.store( nullptr ); }
+    inline std::atomic<PoolItem*>& Next() { return( _next ); }
+    inline const std::atomic<PoolItem*>& Next() const { return( _next ); }
+    inline std::atomic<pSzt>& Refs() { return( _refs ); }
+    inline PoolItem* LoadNextSpeculative() const { return( LoadSpeculative( _next ) ); }
+    inline T* Data() { return( reinterpret_cast<T*>( &_data ) ); }
+    static inline PoolItem* FromData( const T* const ptr ) { return( (PoolItem*) ptr ); }
+};
+
+/**
+ * The free-list link overlays the payload of a free slot, so a slot is 
+ * max( sizeof(T), sizeof(void*) ) bytes rounded up to the slot alignment. 
+ * Concurrent poppers may read the link of a slot that was just handed out, 
+ * the tagged CAS on the chunk head discards such reads.
+ *
+ * Such a read still races with the constructor of the T that the new owner 
+ * places over the same bytes, so every read that may hit a handed-out slot 
+ * goes through LoadNextSpeculative(), see LoadSpeculative().
+ */
+template<typename T, typename Layout> struct alignas( Layout::template SlotAlign<T>() ) PoolItem<T, Layout, true>
+{
+    static constexpr pSzt storageSize = Layout::template SlotAlign<T>();
+    static constexpr pBool hasRefCount = false;
+
+    union
     {
-        _abaCount = abaCount;
-    }
+        std::aligned_storage_t<sizeof(T), alignof(T)> _data;
+        std::atomic<PoolItem*> _next;
+    };
+    PoolItem() { _next.store( nullptr ); }
+    inline std::atomic<PoolItem*>& Next() { return( _next ); }
+    inline const std::atomic<PoolItem*>& Next() const { return( _next ); }
+    inline PoolItem* LoadNextSpeculative() const { return( LoadSpeculative( _next ) ); }
+    inline T* Data() { return( reinterpret_cast<T*>( &_data ) ); }
+    static inline PoolItem* FromData( const T* const ptr ) { return( (PoolItem*) ptr ); }
 };
 
-template<typename T> class PoolChunk
+/**
+ * A chunk is one block aligned to a power of two that holds this header 
+ * followed by its items, so the owning chunk of an item is found by masking 
+ * the item address with the block alignment. The head and tail sentinels 
+ * of the chunk list are plain heap objects without items.
+ */
+template<typename T, typename Traits = DefaultPoolTraits> class PoolChunk
 {
-    using PoolItemT = PoolItem<T>;
+    using PoolItemT = PoolItem<T, typename Traits::ItemLayout>;
+    using TaggerT = typename Traits::TagPolicy::template Tagger<PoolItemT>;
+    using ChunkMemory = typename Traits::ChunkMemory;
+    using BackoffPolicy = typename Traits::BackoffPolicy;
 
-    std::unique_ptr<PoolItemT[]> _itemsArray;
     std::atomic<PoolItemT*> _nextFreeItem;
     std::atomic<PoolChunk*> _next;
+    std::atomic<pSzt> _nLive;
     PoolItemT* _firstItemAddr;
+    pSzt _nItems;
 
-    const AddressTagger<PoolItemT>* _aTagPtr;
+    const TaggerT* _aTagPtr;
+    void* _owner;
+    pSzt _handleId;
 
-public:  
-    PoolChunk()
-    {
-        _nextFreeItem.store( nullptr );
-        _next.store( nullptr );
-        _aTagPtr = nullptr;
-    }
-    explicit PoolChunk( pSzt nItems, AddressTagger<PoolItemT> const * const aTagPtr )
+    explicit PoolChunk( pSzt nItems, TaggerT const * const aTagPtr, void* owner )
     {
-        _itemsArray = std::make_unique<PoolItemT[]>( nItems );
-        _nextFreeItem.store( &_itemsArray[0] );
-        _firstItemAddr = &_itemsArray[0];
+        PoolItemT* items = reinterpret_cast<PoolItemT*>( reinterpret_cast<pChr*>( this ) + ItemsOffset() );
+        for ( pSzt i( 0 ) ; i< nItems ; ++i )
+        {
+            new ( &items[ i ] ) PoolItemT();
+        }
+        _nextFreeItem.store( &items[0] );
+        _firstItemAddr = &items[0];
+        _nItems = nItems;
 
         pSzt nItems1 = nItems - 1;
         for ( pSzt i( 0 ) ; i< nItems1 ; ++i )
         {
-            _itemsArray[ i ]._next.store( &_itemsArray[ i + 1 ] );
+            items[ i ].Next().store( &items[ i + 1 ] );
         }
-        _itemsArray[ nItems1 ]._next.store( nullptr );
+        items[ nItems1 ].Next().store( nullptr );
 
         _next.store( nullptr );
+        _nLive.store( 0 );
         _aTagPtr = aTagPtr;
+        _owner = owner;
+        _handleId = 0;
+    }
+
+public:  
+    PoolChunk()
+    {
+        _nextFreeItem.store( nullptr );
+        _next.store( nullptr );
+        _nLive.store( 0 );
+        _firstItemAddr = nullptr;
+        _nItems = 0;
+        _aTagPtr = nullptr;
+        _owner = nullptr;
+        _handleId = 0;
     }
     ~PoolChunk() = default;
 
+    static constexpr pSzt ItemsOffset()
+    {
+        return( ( sizeof( PoolChunk ) + alignof( PoolItemT ) - 1 ) / alignof( PoolItemT ) * alignof( PoolItemT ) );
+    }
+    static constexpr pSzt BlockSize( pSzt nItems )
+    {
+        return( ItemsOffset() + nItems * sizeof( PoolItemT ) );
+    }
+    static PoolChunk* Create( pSzt nItems, TaggerT const * const aTagPtr, void* owner, pSzt blockAlign, pBool populate = false )
+    {
+        void* block = ChunkMemory::Allocate( BlockSize( nItems ), blockAlign, populate );
+        return( new ( block ) PoolChunk( nItems, aTagPtr, owner ) );
+    }
+    static void Destroy( PoolChunk* chunk, pSzt blockAlign )
+    {
+        pSzt blockSize = BlockSize( chunk->Capacity() );
+        chunk->~PoolChunk();
+        ChunkMemory::Release( chunk, blockSize, blockAlign );
+    }
+    static PoolChunk* ChunkOf( const PoolItemT* const item, pSzt blockAlign )
+    {
+        return( reinterpret_cast<PoolChunk*>( reinterpret_cast<pUIntPtrT>( item ) & ~( blockAlign - 1 ) ) );
+    }
+
     inline PoolItemT* GetFirstItemAddr() const { return( _firstItemAddr ); }
+    inline pSzt Capacity() const { return( _nItems ); }
+    inline void* GetOwner() const { return( _owner ); }
+    inline pSzt GetHandleId() const { return( _handleId ); }
+    inline void SetHandleId( pSzt handleId ) { _handleId = handleId; }
 
+    /**
+     * Free items derived from the live count, exact once the chunk is quiescent.
+     */
     pSzt Size() const
     {
-        pSzt sz = 0;
-        PoolItemT* cItem = _aTagPtr->GetCleanAddr( _nextFreeItem.load() );
-        while( cItem != nullptr )
-        {
-            sz++;
-            cItem = _aTagPtr->GetCleanAddr( cItem->_next.load() );
-        }
+        pSzt nLive = _nLive.load( std::memory_order_relaxed );
+        return( nLive < _nItems ? _nItems - nLive : 0 );
+    }
 
-        return( sz );
+    /**
+     * Number of items handed out of this chunk and not returned yet, as a 
+     * hint: allocations count after the pop that hands items out, frees 
+     * before the push that returns them.
+     */
+    std::atomic<pSzt>& GetAtomLive()
+    {
+        return( _nLive );
     }
 
     PoolItemT* GetNextFreeItem() const
@@ -113,7 +350,8 @@ public:
     void SetNextChunk( PoolChunk* nextChunk )
     {
         PoolChunk* curChunk = _next.load();
-        while ( !_next.compare_exchange_weak( curChunk, nextChunk ) );
+        BackoffPolicy backoff;
+        while ( !_next.compare_exchange_weak( curChunk, nextChunk ) ) backoff.Pause();
     }
     PoolChunk* GetNextChunk() 
     {
@@ -126,56 +364,558 @@ public:
 };
 
 
-template<typename T> class LockFreeObjPool : public BaseObjectPool<T>
+/**
+ * Snapshot of pool counters. Fields are read one by one without a common 
+ * lock, so under concurrent use they may disagree by in-flight operations.
+ */
+struct PoolStats
+{
+    pSzt allocations;
+    pSzt frees;
+    pSzt liveObjects;
+    pSzt freeSlots;
+    pSzt capacity;
+    pSzt chunks;
+    pSzt idleChunks;
+    pSzt bytesReserved;
+    pSzt growthEvents;
+    pSzt chunksReleased;
+    pSzt standbyChunks;
+};
+
+template<typename T, typename Traits> class ShardedObjPool;
+template<typename T, typename Traits> struct PoolDeleter;
+template<typename T, typename Traits> class PoolSharedPtr;
+
+template<typename T, typename Traits = DefaultPoolTraits> using PoolUniquePtr = std::unique_ptr<T, PoolDeleter<T, Traits>>;
+
+template<typename T, typename Traits = DefaultPoolTraits> class LockFreeObjPool : public StaticObjectPool<LockFreeObjPool<T, Traits>, T>
 {
-    using PoolChunkT = PoolChunk<T>;
-    using PoolItemT = PoolItem<T>;
+    friend class StaticObjectPool<LockFreeObjPool<T, Traits>, T>;
+    friend class ShardedObjPool<T, Traits>;
+
+    using PoolChunkT = PoolChunk<T, Traits>;
+    using PoolItemT = PoolItem<T, typename Traits::ItemLayout>;
+    using GrowthPolicy = typename Traits::GrowthPolicy;
+    using TagPolicy = typename Traits::TagPolicy;
+    using TaggerT = typename TagPolicy::template Tagger<PoolItemT>;
+    using ShrinkPolicy = typename Traits::ShrinkPolicy;
+    using Instrumentation = typename Traits::Instrumentation;
+    using StripePolicy = typename Traits::StripePolicy;
+    using HandlePolicy = typename Traits::HandlePolicy;
+    using BackoffPolicy = typename Traits::BackoffPolicy;
+    using ProvisionPolicy = typename Traits::ProvisionPolicy;
+
+    static_assert( TagPolicy::template TagBits<PoolItemT>( PoolItemT::storageSize ) >= 5, 
+                   "fewer than 32 ABA tag values, use a larger slot alignment or HighBitTagging" );
+
+public:
+    static constexpr pSzt slotAlign = PoolItemT::storageSize;
+
+private:
+
+    static constexpr pSzt _defMagazineSize = 64;
+    static constexpr pSzt _nStripes = StripePolicy::stripes;
+    static constexpr pSzt _maxChunkItems = GrowthPolicy::MaxItemsPerChunk( sizeof( PoolItemT ) );
+    static constexpr pSzt _chunkBlockAlign = pmath::CeilPow2( PoolChunkT::BlockSize( _maxChunkItems ) );
 
-    static constexpr pSzt _nItems = 1000;
+    /**
+     * Per-thread LIFO of free items. A magazine is only ever touched by the 
+     * thread owning its thId, so the fast path needs no shared atomics; 
+     * _count and the allocation and free counts are atomic only so Size() 
+     * and Stats() may read them from other threads. The owner updates them 
+     * with a relaxed load and store, never a read-modify-write.
+     */
+    struct alignas( 64 ) Magazine
+    {
+        std::unique_ptr<PoolItemT*[]> _items;
+        std::atomic<pSzt> _count;
+        std::atomic<pSzt> _nAllocs;
+        std::atomic<pSzt> _nFrees;
+
+        Magazine() 
+        { 
+            _count.store( 0 ); 
+            _nAllocs.store( 0 );
+            _nFrees.store( 0 );
+        }
+    };
+
+    /**
+     * Chunks are only ever released by Trim(), so only pools with a shrink 
+     * policy run chunk walks and allocations under an epoch guard; for the 
+     * others the guard is inactive.
+     */
+    struct ChunkGuard
+    {
+        EpochDomain::Guard _guard;
+
+        explicit ChunkGuard( EpochDomain* domain ) : _guard( domain ) {}
+        void Retire( PoolChunkT* chunk )
+        {
+            _guard.Retire( chunk, &reclaimChunk, nullptr );
+        }
+    };
+
+    struct alignas( 64 ) AllocStripe
+    {
+        std::atomic<PoolChunkT*> _chunk;
+    };
 
     std::atomic<PoolChunkT*> _headChunk;
     std::atomic<PoolChunkT*> _tailChunk;
+    AllocStripe _allocStripes[ _nStripes ];
+
+    TaggerT _addrTagger;
+
+    std::unique_ptr<Magazine[]> _magazines;
+    pSzt _nMagazines;
+    pSzt _magazineSize;
+
+    std::atomic<pSzt> _nextChunkItems;
+    std::atomic<pSzt> _nChunks;
+    std::atomic<pSzt> _nIdleChunks;
+    std::atomic<pSzt> _capacity;
+    std::atomic<pSzt> _bytesReserved;
+    std::atomic<pSzt> _nGrowths;
+    std::atomic<pSzt> _nReleased;
+
+    StripedCounter<> _nAllocs;
+    StripedCounter<> _nFrees;
 
-    AddressTagger<PoolItemT> _addrTagger;
+    Instrumentation _instr;
 
-    void createInsertNewChunk()
+    std::unique_ptr<EpochDomain> _epochDomain;
+
+    /**
+     * Handle table entry of one chunk id. The generations of an id outlive 
+     * its chunks, so a chunk reusing the id after Trim() keeps counting up 
+     * where the released one stopped and old handles stay stale.
+     */
+    struct HandleSlot
+    {
+        std::atomic<PoolItemT*> _firstItem;
+        std::atomic<std::atomic<pUInt32>*> _gens;
+
+        HandleSlot() { _firstItem.store( nullptr ); _gens.store( nullptr ); }
+        ~HandleSlot() { delete[] _gens.load(); }
+    };
+
+    std::unique_ptr<HandleSlot[]> _handleTable;
+    pSztVec _freeHandleIds;
+    pSzt _nHandleIds;
+
+    /**
+     * Only called with _needNewChunk held. Returns false once all chunk ids 
+     * are in use.
+     */
+    pBool registerHandleChunk( PoolChunkT* chunk )
+    {
+        pSzt id( 0 );
+        if ( !_freeHandleIds.empty() )
+        {
+            id = _freeHandleIds.back();
+            _freeHandleIds.pop_back();
+        }
+        else if ( _nHandleIds < HandlePolicy::maxChunks )
+        {
+            id = _nHandleIds++;
+        }
+        else
+        {
+            return( false );
+        }
+        HandleSlot& hs = _handleTable[ id ];
+        if ( !hs._gens.load() )
+        {
+            std::atomic<pUInt32>* gens = new std::atomic<pUInt32>[ _maxChunkItems ];
+            for ( pSzt i( 0 ) ; i< _maxChunkItems ; ++i ) gens[ i ].store( 0, std::memory_order_relaxed );
+            hs._gens.store( gens, std::memory_order_release );
+        }
+        chunk->SetHandleId( id );
+        hs._firstItem.store( chunk->GetFirstItemAddr(), std::memory_order_release );
+        return( true );
+    }
+    void unregisterHandleChunk( PoolChunkT* chunk )
     {
-        PoolChunkT* newChunk = new PoolChunkT( _nItems, &_addrTagger );
+        _handleTable[ chunk->GetHandleId() ]._firstItem.store( nullptr, std::memory_order_release );
+        _freeHandleIds.push_back( chunk->GetHandleId() );
+    }
+    std::atomic<pUInt32>& generationOf( const PoolItemT* const item ) const
+    {
+        PoolChunkT* chunk = PoolChunkT::ChunkOf( item, _chunkBlockAlign );
+        return( _handleTable[ chunk->GetHandleId() ]._gens.load( std::memory_order_relaxed )[ item - chunk->GetFirstItemAddr() ] );
+    }
+    /**
+     * Invalidates the handles of ptr before its slot goes back to a free list.
+     */
+    void bumpGeneration( const T* const ptr )
+    {
+        if constexpr ( HandlePolicy::enabled )
+        {
+            std::atomic<pUInt32>& gen = generationOf( PoolItemT::FromData( ptr ) );
+            gen.store( gen.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+        }
+    }
+
+    static void reclaimChunk( void* /*ctx*/, void* chunk )
+    {
+        PoolChunkT::Destroy( static_cast<PoolChunkT*>( chunk ), _chunkBlockAlign );
+    }
+
+    /**
+     * Only called with _needNewChunk held. The new chunk, a standby chunk if 
+     * one is left, goes to the front of the list. Returns nullptr once the 
+     * growth policy's chunk limit or, with handles, the handle table is 
+     * reached.
+     */
+    PoolChunkT* createInsertNewChunk( pBool populate = false )
+    {
+        if ( GrowthPolicy::maxChunks && _nChunks.load() >= GrowthPolicy::maxChunks )
+        {
+            return( nullptr );
+        }
+        PoolChunkT* newChunk = takeStandbyChunk();
+        if ( !newChunk )
+        {
+            newChunk = PoolChunkT::Create( _nextChunkItems.load(), &_addrTagger, this, _chunkBlockAlign, populate );
+            _bytesReserved.fetch_add( PoolChunkT::BlockSize( newChunk->Capacity() ) );
+        }
+        pSzt nItems = newChunk->Capacity();
+        if constexpr ( HandlePolicy::enabled )
+        {
+            if ( !registerHandleChunk( newChunk ) )
+            {
+                _bytesReserved.fetch_sub( PoolChunkT::BlockSize( nItems ) );
+                PoolChunkT::Destroy( newChunk, _chunkBlockAlign );
+                return( nullptr );
+            }
+        }
         PoolChunkT* hChunkNext = _headChunk.load()->GetNextChunk();
-        _headChunk.load()->SetNextChunk( newChunk );
         newChunk->SetNextChunk( hChunkNext );
+        _headChunk.load()->SetNextChunk( newChunk );
+
+        // A standby chunk may be smaller than the growth policy's next one by now.
+        _nextChunkItems.store( std::max( _nextChunkItems.load(), GrowthPolicy::NextChunkItems( nItems, sizeof( PoolItemT ) ) ) );
+        _nChunks.fetch_add( 1 );
+        _nIdleChunks.fetch_add( 1 );
+        _capacity.fetch_add( nItems );
+        _nGrowths.fetch_add( 1 );
+        return( newChunk );
+    }
+
+    /**
+     * Standby chunks are built but not linked yet. Only the refiller adds 
+     * to the list and only growth takes from it, both under _needNewChunk; 
+     * chunks are built before the lock is taken.
+     */
+    std::array<PoolChunkT*, std::max<pSzt>( ProvisionPolicy::highWatermark, 1 )> _standby;
+    std::atomic<pSzt> _nStandby;
+    std::atomic<pBool> _refilling;
+
+    /**
+     * The background refiller of StandbyChunks<..., true>. _requested and 
+     * _stop only change under _mtx, so a request posted while the thread is 
+     * about to wait is never lost.
+     */
+    struct Provisioner
+    {
+        std::mutex _mtx;
+        std::condition_variable _cv;
+        pBool _requested = false;
+        pBool _stop = false;
+        std::thread _thread;
+    };
+    std::unique_ptr<Provisioner> _provisioner;
+
+    void signalProvisioner( pBool stop )
+    {
+        std::lock_guard<std::mutex> lock( _provisioner->_mtx );
+        if ( stop ) _provisioner->_stop = true;
+        else _provisioner->_requested = true;
+        _provisioner->_cv.notify_one();
+    }
+
+    PoolChunkT* takeStandbyChunk()
+    {
+        if constexpr ( ProvisionPolicy::enabled )
+        {
+            pSzt nStandby = _nStandby.load();
+            if ( !nStandby ) return( nullptr );
+            PoolChunkT* chunk = _standby[ nStandby - 1 ];
+            _nStandby.store( nStandby - 1 );
+            if ( nStandby - 1 <= ProvisionPolicy::lowWatermark && _provisioner ) signalProvisioner( false );
+            return( chunk );
+        }
+        return( nullptr );
+    }
+    pBool standbyNeeded() const
+    {
+        if ( GrowthPolicy::maxChunks && _nChunks.load( std::memory_order_relaxed ) + _nStandby.load( std::memory_order_relaxed ) >= GrowthPolicy::maxChunks ) 
+        {
+            return( false );
+        }
+        return( _nStandby.load( std::memory_order_relaxed ) < ProvisionPolicy::highWatermark );
+    }
+    /**
+     * Builds at most maxBuilt standby chunks, stopping at the high 
+     * watermark. Returns at once if another thread is refilling. A chunk 
+     * that cannot be allocated ends the refill quietly: the next growth 
+     * then builds inline and reports the failure to its caller.
+     */
+    void refillStandby( pSzt maxBuilt ) noexcept
+    {
+        pBool refilling( false );
+        if ( !_refilling.compare_exchange_strong( refilling, true ) ) return;
+        for ( pSzt nBuilt( 0 ) ; nBuilt< maxBuilt && standbyNeeded() ; ++nBuilt )
+        {
+            PoolChunkT* chunk = nullptr;
+            try
+            {
+                chunk = PoolChunkT::Create( _nextChunkItems.load(), &_addrTagger, this, _chunkBlockAlign );
+            }
+            catch ( std::bad_alloc& )
+            {
+                break;
+            }
+            lockChunkList( true );
+            _standby[ _nStandby.load() ] = chunk;
+            _nStandby.fetch_add( 1 );
+            _bytesReserved.fetch_add( PoolChunkT::BlockSize( chunk->Capacity() ) );
+            unlockChunkList();
+        }
+        _refilling.store( false );
+    }
+    /**
+     * Cooperative refill, run by Destruct. Builds one chunk per call, so a 
+     * single free never pays for more than one chunk.
+     */
+    inline void maybeProvision() noexcept
+    {
+        if constexpr ( ProvisionPolicy::enabled && !ProvisionPolicy::background )
+        {
+            if ( _nStandby.load( std::memory_order_relaxed ) <= ProvisionPolicy::lowWatermark && standbyNeeded() ) refillStandby( 1 );
+        }
+    }
+    void provisionLoop()
+    {
+        std::unique_lock<std::mutex> lock( _provisioner->_mtx );
+        while ( true )
+        {
+            _provisioner->_cv.wait( lock, [this]() { return( _provisioner->_stop || _provisioner->_requested ); } );
+            if ( _provisioner->_stop ) break;
+            _provisioner->_requested = false;
+            lock.unlock();
+            refillStandby( ProvisionPolicy::highWatermark );
+            lock.lock();
+        }
     }
 
+    /**
+     * Guards every change to the chunk list and to the allocation stripes: 
+     * growth, switching an allocation chunk and Trim().
+     */
     std::atomic<pBool> _needNewChunk;
 
+    pBool lockChunkList( pBool wait )
+    {
+        auto probe = _instr.Begin( CasSite::ChunkListLock );
+        pBool needNewChunk( false );
+        while ( !_needNewChunk.compare_exchange_weak( needNewChunk, true ) )
+        {
+            if ( !wait ) return( false );
+            needNewChunk = false;
+            probe.Retry();
+            std::this_thread::yield();
+        }
+        _instr.End( CasSite::ChunkListLock, probe );
+        return( true );
+    }
+    void unlockChunkList()
+    {
+        _needNewChunk.store( false );
+    }
+
 public:
-    LockFreeObjPool() : _addrTagger( 0b11111 )
+    /**
+     * nMagazines > 0 enables the per-thread magazine layer: Construct( hint, ... ) 
+     * and Destruct( hint, ptr ) then go through magazine hint % nMagazines. 
+     * A given hint must not be used by two threads at the same time.
+     */
+    explicit LockFreeObjPool( pSzt nMagazines = 0, pSzt magazineSize = _defMagazineSize ) 
+        : _addrTagger( TagPolicy::template MakeTagger<PoolItemT>( PoolItemT::storageSize ) ), _nMagazines( nMagazines ), _magazineSize( std::max<pSzt>( magazineSize, 2 ) )
     {
         _headChunk.store( new PoolChunkT() );
         _tailChunk.store( new PoolChunkT() );
         _headChunk.load()->SetNextChunk( _tailChunk.load() );
 
-        createInsertNewChunk();
+        _nextChunkItems.store( GrowthPolicy::InitialChunkItems( sizeof( PoolItemT ) ) );
+        _nChunks.store( 0 );
+        _nIdleChunks.store( 0 );
+        _capacity.store( 0 );
+        _bytesReserved.store( 0 );
+        _nReleased.store( 0 );
+        _nStandby.store( 0 );
+        _refilling.store( false );
+        _nHandleIds = 0;
+        if constexpr ( HandlePolicy::enabled )
+        {
+            _handleTable = std::make_unique<HandleSlot[]>( HandlePolicy::maxChunks );
+        }
+        PoolChunkT* firstChunk = createInsertNewChunk();
+        for ( AllocStripe& stripe : _allocStripes ) stripe._chunk.store( firstChunk );
+        _nGrowths.store( 0 );
         _needNewChunk.store( false );
+
+        if constexpr ( ShrinkPolicy::enabled )
+        {
+            _epochDomain = std::make_unique<EpochDomain>( 128, 1 );
+        }
+
+        if ( _nMagazines )
+        {
+            _magazines = std::make_unique<Magazine[]>( _nMagazines );
+            for ( pSzt i( 0 ) ; i< _nMagazines ; ++i )
+            {
+                _magazines[ i ]._items = std::make_unique<PoolItemT*[]>( _magazineSize );
+            }
+        }
+
+        // Last, nothing may throw once the provisioner thread runs.
+        if constexpr ( ProvisionPolicy::enabled )
+        {
+            refillStandby( ProvisionPolicy::highWatermark );
+            if constexpr ( ProvisionPolicy::background )
+            {
+                _provisioner = std::make_unique<Provisioner>();
+                _provisioner->_thread = std::thread( [this]() { provisionLoop(); } );
+            }
+        }
     } 
     ~LockFreeObjPool()
     {
-        PoolChunkT* cChunk = _headChunk.load();
-        while ( cChunk )
+        if ( _provisioner )
+        {
+            signalProvisioner( true );
+            _provisioner->_thread.join();
+        }
+        for ( pSzt i( 0 ) ; i< _nStandby.load() ; ++i ) PoolChunkT::Destroy( _standby[ i ], _chunkBlockAlign );
+        _epochDomain.reset();
+
+        PoolChunkT* cChunk = _headChunk.load()->GetNextChunk();
+        while ( cChunk != _tailChunk.load() )
         {
             PoolChunkT* nChunk = cChunk->GetNextChunk();
-            delete cChunk;
+            PoolChunkT::Destroy( cChunk, _chunkBlockAlign );
             cChunk = nChunk;
         }
+        delete _headChunk.load();
+        delete _tailChunk.load();
+    }
+
+    pBool AddOneChunk()
+    {
+        lockChunkList( true );
+        pBool added = createInsertNewChunk() != nullptr;
+        unlockChunkList();
+        return( added );
+    }
+
+    /**
+     * Grows the pool up front until it can hold nObjects in total, so a 
+     * service pays for chunk construction at startup instead of during its 
+     * first burst. With prefault, ChunkMemory populates each block in one go 
+     * (MAP_POPULATE for mmap) before the slots are linked. Returns false if 
+     * the growth policy's chunk limit stops it early.
+     */
+    pBool Reserve( pSzt nObjects, pBool prefault = true )
+    {
+        lockChunkList( true );
+        pBool reached( true );
+        while ( _capacity.load() < nObjects )
+        {
+            if ( !createInsertNewChunk( prefault ) )
+            {
+                reached = false;
+                break;
+            }
+        }
+        unlockChunkList();
+        return( reached );
+    }
+
+    pSzt ChunkCount() const
+    {
+        return( _nChunks.load() );
+    }
+
+    /**
+     * The pool that handed out ptr, found from the owning chunk in O(1). 
+     * ptr must come from a LockFreeObjPool of the same T and Traits.
+     */
+    static LockFreeObjPool* OwnerOf( const T* const ptr )
+    {
+        PoolChunkT* chunk = PoolChunkT::ChunkOf( PoolItemT::FromData( ptr ), _chunkBlockAlign );
+        return( static_cast<LockFreeObjPool*>( chunk->GetOwner() ) );
     }
 
-    void AddOneChunk()
+    /**
+     * Chunks none of whose items are currently handed out.
+     */
+    pSzt IdleChunkCount() const
     {
-        createInsertNewChunk();
+        return( _nIdleChunks.load() );
+    }
+
+    /**
+     * Unlinks and frees completely free chunks until at most keepIdle idle 
+     * chunks remain, the current allocation chunk is always kept. Returns 
+     * the number of chunks released. Needs a ShrinkPolicy in the traits.
+     */
+    pSzt Trim( pSzt keepIdle = ShrinkPolicy::lowIdleChunks )
+    {
+        static_assert( ShrinkPolicy::enabled, "Trim() needs a ShrinkPolicy such as IdleChunkShrink or ManualShrink" );
+        return( trim( keepIdle, true ) );
+    }
+
+    /**
+     * CAS retry and spin-time histograms when Traits::Instrumentation records them.
+     */
+    Instrumentation const& GetInstrumentation() const
+    {
+        return( _instr );
+    }
+
+    /**
+     * Reads counters only, no chunk or free list is walked. Allocations and 
+     * frees count objects handed to and returned by the user, so objects 
+     * parked in magazines count as free slots.
+     */
+    PoolStats Stats() const
+    {
+        PoolStats st;
+        st.frees = _nFrees.Load();
+        st.allocations = _nAllocs.Load();
+        for ( pSzt i( 0 ) ; i< _nMagazines ; ++i )
+        {
+            st.frees += _magazines[ i ]._nFrees.load( std::memory_order_relaxed );
+            st.allocations += _magazines[ i ]._nAllocs.load( std::memory_order_relaxed );
+        }
+        st.liveObjects = st.allocations > st.frees ? st.allocations - st.frees : 0;
+        st.capacity = _capacity.load( std::memory_order_relaxed );
+        st.freeSlots = st.capacity > st.liveObjects ? st.capacity - st.liveObjects : 0;
+        st.chunks = _nChunks.load( std::memory_order_relaxed );
+        st.idleChunks = _nIdleChunks.load( std::memory_order_relaxed );
+        st.bytesReserved = _bytesReserved.load( std::memory_order_relaxed );
+        st.growthEvents = _nGrowths.load( std::memory_order_relaxed );
+        st.chunksReleased = _nReleased.load( std::memory_order_relaxed );
+        st.standbyChunks = _nStandby.load( std::memory_order_relaxed );
+        return( st );
     }
 
     pSzt Size() const
     {
+        ChunkGuard guard( _epochDomain.get() );
         pSzt sz = 0;
         PoolChunkT* cChunk = _headChunk.load();
         cChunk = cChunk->GetNextChunk();
@@ -184,11 +924,16 @@ public:
             sz += cChunk->Size();
             cChunk = cChunk->GetNextChunk();
         }
+        for ( pSzt i( 0 ) ; i< _nMagazines ; ++i )
+        {
+            sz += _magazines[ i ]._count.load( std::memory_order_relaxed );
+        }
         return( sz );
     }
 
     std::vector<pSzt> SizePerChunk() const
     {
+        ChunkGuard guard( _epochDomain.get() );
         std::vector<pSzt> szV;
         PoolChunkT* cChunk = _headChunk.load();
         cChunk = cChunk->GetNextChunk();
@@ -200,83 +945,705 @@ public:
         return( szV );
     }
 
-    template<typename I, typename... ArgsType> T* Construct( I thId, ArgsType&&... args )
+    using StaticObjectPool<LockFreeObjPool<T, Traits>, T>::Construct;
+
+    /**
+     * Construct wrapped in a unique_ptr whose deleter is stateless: it finds 
+     * the pool through the owning chunk. Empty if the pool is exhausted.
+     */
+    template<typename... ArgsType> PoolUniquePtr<T, Traits> MakeUnique( ThreadHint hint, ArgsType&&... args )
     {
-        T* ptr = allocate( thId );
-        if ( !ptr ) return( nullptr );
-        return( new ( ptr ) T( thId, std::forward<ArgsType>( args )... ) );
+        return( PoolUniquePtr<T, Traits>( Construct( hint, std::forward<ArgsType>( args )... ) ) );
     }
-    virtual void Destruct( const T* const ptr ) noexcept override
+    template<typename... ArgsType> PoolUniquePtr<T, Traits> MakeUnique( ArgsType&&... args )
     {
-        if ( ptr ) deallocate( ptr ); 
+        return( PoolUniquePtr<T, Traits>( Construct( std::forward<ArgsType>( args )... ) ) );
+    }
+    /**
+     * Construct wrapped in an intrusive PoolSharedPtr. The reference count 
+     * lives in the slot itself, so shared ownership costs no allocation. 
+     * Needs the split item layout. Empty if the pool is exhausted.
+     */
+    template<typename... ArgsType> PoolSharedPtr<T, Traits> MakeShared( ThreadHint hint, ArgsType&&... args )
+    {
+        return( makeShared( Construct( hint, std::forward<ArgsType>( args )... ) ) );
+    }
+    template<typename... ArgsType> PoolSharedPtr<T, Traits> MakeShared( ArgsType&&... args )
+    {
+        return( makeShared( Construct( std::forward<ArgsType>( args )... ) ) );
+    }
+
+    /**
+     * Hands out n raw slots into out. Every run of slots is detached from a 
+     * chunk free list with a single CAS. Returns the number of slots written.
+     */
+    pSzt AllocateBulk( pSzt n, T** out )
+    {
+        return( allocateBulk( threadStripe(), n, out ) );
+    }
+    /**
+     * Emplaces T( args... ) into up to n slots taken with AllocateBulk. 
+     * Returns the number of objects written to out.
+     */
+    template<typename... ArgsType> pSzt ConstructN( ThreadHint hint, pSzt n, T** out, const ArgsType&... args )
+    {
+        return( constructN( allocateBulk( stripeOf( hint._id ), n, out ), out, args... ) );
+    }
+    template<typename... ArgsType> pSzt ConstructN( pSzt n, T** out, const ArgsType&... args )
+    {
+        return( constructN( allocateBulk( threadStripe(), n, out ), out, args... ) );
+    }
+    /**
+     * Destroys the n objects of ptrs, links their slots together and 
+     * reattaches them with one CAS. nullptr entries are skipped.
+     */
+    void DestructBulk( T* const* ptrs, pSzt n ) noexcept
+    {
+        for ( pSzt i( 0 ) ; i< n ; ++i )
+        {
+            if ( !ptrs[ i ] ) continue;
+            this->destroy( ptrs[ i ] );
+            bumpGeneration( ptrs[ i ] );
+        }
+        _nFrees.Add( deallocateItems( ptrs, n ) );
+        maybeProvision();
+    }
+
+    /**
+     * Returns every item cached in the magazine of hint to the shared free lists. 
+     * Must be called from the thread owning hint, e.g. before it exits.
+     */
+    void FlushMagazine( ThreadHint hint )
+    {
+        if ( !_nMagazines ) return;
+        Magazine& mag = magazineFor( hint._id );
+        pSzt count = mag._count.load( std::memory_order_relaxed );
+        mag._count.store( flushMagazine( mag, count, count ), std::memory_order_relaxed );
+    }
+
+    /**
+     * Handle front end, needs Traits::HandlePolicy = GenerationalHandles<...>. 
+     * A handle stays valid until its object is destroyed by any Destruct 
+     * overload; Resolve then returns nullptr. Resolving a handle whose object 
+     * is destroyed concurrently is a race, as with raw pointers.
+     */
+    using Handle = typename HandlePolicy::HandleT;
+    static constexpr Handle NullHandle = ~Handle( 0 );
+
+    Handle HandleOf( const T* const ptr ) const
+    {
+        static_assert( HandlePolicy::enabled, "handles need Traits::HandlePolicy = GenerationalHandles<...>" );
+        if ( !ptr ) return( NullHandle );
+        const PoolItemT* item = PoolItemT::FromData( ptr );
+        PoolChunkT* chunk = PoolChunkT::ChunkOf( item, _chunkBlockAlign );
+        pUInt64 slot = chunk->GetHandleId() * _maxChunkItems + ( item - chunk->GetFirstItemAddr() );
+        pUInt64 gen = generationOf( item ).load( std::memory_order_relaxed ) & _genMask;
+        return( static_cast<Handle>( ( gen << HandlePolicy::slotBits ) | slot ) );
+    }
+    T* Resolve( Handle handle ) const
+    {
+        static_assert( HandlePolicy::enabled, "handles need Traits::HandlePolicy = GenerationalHandles<...>" );
+        pUInt64 slot = static_cast<pUInt64>( handle ) & _slotMask;
+        if ( slot >= HandlePolicy::maxChunks * _maxChunkItems ) return( nullptr );
+        HandleSlot const& hs = _handleTable[ slot / _maxChunkItems ];
+        std::atomic<pUInt32>* gens = hs._gens.load( std::memory_order_acquire );
+        if ( !gens ) return( nullptr );
+        pSzt idx = slot % _maxChunkItems;
+        if ( ( gens[ idx ].load( std::memory_order_acquire ) & _genMask ) != ( static_cast<pUInt64>( handle ) >> HandlePolicy::slotBits ) ) 
+        {
+            return( nullptr );
+        }
+        PoolItemT* firstItem = hs._firstItem.load( std::memory_order_acquire );
+        return( firstItem ? firstItem[ idx ].Data() : nullptr );
+    }
+    template<typename... ArgsType> Handle ConstructHandle( ThreadHint hint, ArgsType&&... args )
+    {
+        return( HandleOf( Construct( hint, std::forward<ArgsType>( args )... ) ) );
+    }
+    template<typename... ArgsType> Handle ConstructHandle( ArgsType&&... args )
+    {
+        return( HandleOf( Construct( std::forward<ArgsType>( args )... ) ) );
+    }
+    /**
+     * Returns false for a stale or null handle.
+     */
+    pBool DestructHandle( Handle handle ) noexcept
+    {
+        T* ptr = Resolve( handle );
+        if ( !ptr ) return( false );
+        this->Destruct( ptr );
+        return( true );
     }
 
 private:
-    virtual T* allocate( pInt thId ) override 
+    static constexpr pUInt64 _slotMask = ( pUInt64( 1 ) << HandlePolicy::slotBits ) - 1;
+    static constexpr pUInt64 _genMask = ( pUInt64( 1 ) << HandlePolicy::generationBits ) - 1;
+
+    static_assert( HandlePolicy::maxChunks * _maxChunkItems <= _slotMask, "handle slot bits too few for MaxChunks full chunks" );
+
+    PoolSharedPtr<T, Traits> makeShared( T* ptr )
+    {
+        static_assert( PoolItemT::hasRefCount, "MakeShared needs SplitItemLayout, compact slots have no room for a reference count" );
+        if ( ptr ) PoolItemT::FromData( ptr )->Refs().store( 1, std::memory_order_relaxed );
+        return( PoolSharedPtr<T, Traits>( ptr ) );
+    }
+    template<typename... ArgsType> pSzt constructN( pSzt nAlloc, T** out, const ArgsType&... args )
+    {
+        pSzt i( 0 );
+        try
+        {
+            for ( ; i< nAlloc ; ++i ) out[ i ] = new ( out[ i ] ) T( args... );
+        }
+        catch ( ... )
+        {
+            // The slots past i hold no object, destroy only the built ones.
+            DestructBulk( out, i );
+            _nFrees.Add( deallocateItems( out + i, nAlloc - i ) );
+            throw;
+        }
+        return( nAlloc );
+    }
+    static PoolItemT* itemOf( const T* const ptr ) { return( PoolItemT::FromData( ptr ) ); }
+    static PoolItemT* itemOf( PoolItemT* item ) { return( item ); }
+
+    template<typename I> Magazine& magazineFor( I thId ) const
+    {
+        return( _magazines[ static_cast<pSzt>( thId ) % _nMagazines ] );
+    }
+
+    /**
+     * Counts of a magazine have a single writer, its owning thread.
+     */
+    static void countOwned( std::atomic<pSzt>& counter )
     {
-        T* ansPtr = nullptr;
-        PoolItemT* nItem = nullptr;
-        while ( !ansPtr )
+        counter.store( counter.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    }
+
+    template<typename I> static pSzt stripeOf( I thId )
+    {
+        return( static_cast<pSzt>( thId ) % _nStripes );
+    }
+    /**
+     * Stripe for calls that carry no ThreadHint.
+     */
+    static pSzt threadStripe()
+    {
+        if constexpr ( _nStripes == 1 ) return( 0 );
+        static thread_local pSzt stripe = std::hash<pThreadId>()( std::this_thread::get_id() ) % _nStripes;
+        return( stripe );
+    }
+    pBool isAllocChunk( PoolChunkT* chunk ) const
+    {
+        for ( AllocStripe const& stripe : _allocStripes )
         {
-            PoolChunkT* cFirstChunk = _headChunk.load()->GetNextChunk();
-            PoolChunkT* newFirstChunk = cFirstChunk;
+            if ( stripe._chunk.load() == chunk ) return( true );
+        }
+        return( false );
+    }
 
-            do 
+    pSzt allocateBulk( pSzt stripe, pSzt n, T** out )
+    {
+        pSzt i( 0 );
+        pSzt nAlloc = allocateItems( stripe, n, [&]( PoolItemT* item ) { out[ i++ ] = item->Data(); } );
+        _nAllocs.Add( nAlloc );
+        return( nAlloc );
+    }
+
+    pSzt refillMagazine( Magazine& mag, pSzt stripe, pSzt nRefill, pBool grow = true )
+    {
+        pSzt count = mag._count.load( std::memory_order_relaxed );
+        allocateItems( stripe, nRefill, [&]( PoolItemT* item ) { mag._items[ count++ ] = item; }, grow );
+        return( count );
+    }
+
+    /**
+     * Sorting by address groups the flushed items into one run per owning 
+     * chunk and rebuilds its free list in address order, so later 
+     * allocations come out cache-adjacent again however they were freed.
+     */
+    pSzt flushMagazine( Magazine& mag, pSzt count, pSzt nFlush )
+    {
+        count -= nFlush;
+        std::sort( &mag._items[ count ], &mag._items[ count ] + nFlush, std::less<PoolItemT*>() );
+        deallocateItems( &mag._items[ count ], nFlush );
+        return( count );
+    }
+
+    /**
+     * The tag of a chunk free-list head counts the operations on that head, 
+     * every successful CAS installs the previous tag + 1. Items carry no ABA 
+     * state, so a pop never writes to a slot before owning it.
+     */
+    inline PoolItemT* nextHead( PoolItemT* oldHead, PoolItemT* newTop ) const
+    {
+        return( _addrTagger.TagAddr( newTop, _addrTagger.GetTag( oldHead ) + 1 ) );
+    }
+
+    PoolItemT* popFreeItem( PoolChunkT* chunk )
+    {
+        PoolItemT* item = nullptr;
+        return( popFreeRun( chunk, 1, item ) ? item : nullptr );
+    }
+
+    void pushFreeItem( PoolChunkT* chunk, PoolItemT* item )
+    {
+        pushFreeRun( chunk, item, item );
+    }
+
+    /**
+     * Detaches up to n items from the top of the chunk free list with one CAS. 
+     * The detached run stays linked through Next(), its length is returned. 
+     * A link is only followed after the head is seen unchanged, since the 
+     * slot it was read from may have been handed out and overwritten.
+     */
+    pSzt popFreeRun( PoolChunkT* chunk, pSzt n, PoolItemT*& firstItem )
+    {
+        auto probe = _instr.Begin( CasSite::PoolAllocPop );
+        BackoffPolicy backoff;
+        PoolItemT* topItem = chunk->GetNextFreeItem();
+        PoolItemT* cTopItem = nullptr;
+        PoolItemT* cNextItem = nullptr;
+        pSzt runLen( 0 );
+        while ( true )
+        {
+            cTopItem = _addrTagger.GetCleanAddr( topItem );
+            if ( !cTopItem )
+            {
+                _instr.End( CasSite::PoolAllocPop, probe );
+                return( 0 );
+            }
+            runLen = 1;
+            cNextItem = _addrTagger.GetCleanAddr( cTopItem->LoadNextSpeculative() );
+            while ( runLen < n && cNextItem )
+            {
+                if ( chunk->GetNextFreeItem() != topItem ) break;
+                ++runLen;
+                cNextItem = _addrTagger.GetCleanAddr( cNextItem->LoadNextSpeculative() );
+            }
+            if ( chunk->GetAtomNextFreeItem().compare_exchange_weak( topItem, nextHead( topItem, cNextItem ) ) ) break;
+            probe.Retry();
+            backoff.Pause();
+        }
+        _instr.End( CasSite::PoolAllocPop, probe );
+        firstItem = cTopItem;
+        return( runLen );
+    }
+
+    /**
+     * Pushes the run firstItem .. lastItem, already linked through Next(), 
+     * onto the chunk free list with one CAS.
+     */
+    void pushFreeRun( PoolChunkT* chunk, PoolItemT* firstItem, PoolItemT* lastItem )
+    {
+        auto probe = _instr.Begin( CasSite::PoolFreePush );
+        BackoffPolicy backoff;
+        PoolItemT* cFreeItem = chunk->GetNextFreeItem();
+        while ( true )
+        {
+            lastItem->Next().store( _addrTagger.GetCleanAddr( cFreeItem ) );
+            if ( chunk->GetAtomNextFreeItem().compare_exchange_weak( cFreeItem, nextHead( cFreeItem, firstItem ) ) ) break;
+            probe.Retry();
+            backoff.Pause();
+        }
+        _instr.End( CasSite::PoolFreePush, probe );
+    }
+
+    /**
+     * Walks from head to tail for a chunk whose items are all free and closes 
+     * its free list with one CAS, validated against a head that did not move 
+     * during the walk. A closed chunk looks empty to every later pop.
+     */
+    pBool closeChunk( PoolChunkT* chunk )
+    {
+        PoolItemT* topItem = chunk->GetNextFreeItem();
+        PoolItemT* cItem = _addrTagger.GetCleanAddr( topItem );
+        pSzt nFree( 0 );
+        while ( cItem && nFree < chunk->Capacity() )
+        {
+            ++nFree;
+            PoolItemT* cNextItem = _addrTagger.GetCleanAddr( cItem->LoadNextSpeculative() );
+            if ( chunk->GetNextFreeItem() != topItem ) return( false );
+            cItem = cNextItem;
+        }
+        if ( cItem || nFree != chunk->Capacity() ) return( false );
+        return( chunk->GetAtomNextFreeItem().compare_exchange_strong( topItem, nextHead( topItem, nullptr ) ) );
+    }
+
+    pSzt trim( pSzt keepIdle, pBool wait )
+    {
+        if ( !lockChunkList( wait ) ) return( 0 );
+        pSzt nReleased( 0 );
+        {
+            ChunkGuard guard( _epochDomain.get() );
+            pSzt nIdleKept( 0 );
+            PoolChunkT* prevChunk = _headChunk.load();
+            PoolChunkT* cChunk = prevChunk->GetNextChunk();
+            while ( cChunk != _tailChunk.load() )
             {
-                PoolItemT* topItem = cFirstChunk->GetNextFreeItem(); 
-                do                 
+                PoolChunkT* nChunk = cChunk->GetNextChunk();
+                if ( !cChunk->GetAtomLive().load() && !isAllocChunk( cChunk ) )
                 {
-                    PoolItemT* cTopItem = _addrTagger.GetCleanAddr( topItem );   
-                    if ( !cTopItem )
+                    if ( nIdleKept < keepIdle )
                     {
-                        pBool needNewChunk = _needNewChunk.load();
-                        while ( !_needNewChunk.compare_exchange_weak( needNewChunk, true ) );
-                        break;
+                        ++nIdleKept;
                     }
-                    ansPtr = (T*) &(cTopItem->_data);
-                    nItem = cTopItem->_next.load();
-                    PoolItemT* cNextItem = _addrTagger.GetCleanAddr( nItem );
-                    if ( cNextItem )
+                    else if ( closeChunk( cChunk ) )
                     {
-                        cNextItem->SetAbaCount( cTopItem->GetAbaCount() + 1 );
-                        nItem = _addrTagger.TagAddr( cNextItem, cNextItem->GetAbaCount() );
+                        prevChunk->SetNextChunk( nChunk );
+                        _nChunks.fetch_sub( 1 );
+                        _nIdleChunks.fetch_sub( 1 );
+                        _capacity.fetch_sub( cChunk->Capacity() );
+                        _bytesReserved.fetch_sub( PoolChunkT::BlockSize( cChunk->Capacity() ) );
+                        _nReleased.fetch_add( 1 );
+                        if constexpr ( HandlePolicy::enabled ) unregisterHandleChunk( cChunk );
+                        guard.Retire( cChunk );
+                        ++nReleased;
+                        cChunk = nChunk;
+                        continue;
                     }
                 }
-                while ( !cFirstChunk->GetAtomNextFreeItem().compare_exchange_weak( topItem, nItem ) );
+                prevChunk = cChunk;
+                cChunk = nChunk;
+            }
+        }
+        unlockChunkList();
+        if ( nReleased ) _epochDomain->Collect();
+        return( nReleased );
+    }
 
-                pBool needNewChunk = _needNewChunk.load();
-                if ( needNewChunk )
-                {
-                    newFirstChunk = new PoolChunkT( _nItems, &_addrTagger );
-                    newFirstChunk->SetNextChunk( cFirstChunk );
-                    while ( !_needNewChunk.compare_exchange_weak( needNewChunk, false ) );
-                }
+    void maybeAutoTrim()
+    {
+        if constexpr ( ShrinkPolicy::autoTrim )
+        {
+            if ( _nIdleChunks.load( std::memory_order_relaxed ) > ShrinkPolicy::highIdleChunks )
+            {
+                trim( ShrinkPolicy::lowIdleChunks, false );
             }
-            while( !_headChunk.load()->GetAtomNextChunk().compare_exchange_weak( cFirstChunk, newFirstChunk ) );
         }
-        return( ansPtr );
     }
-    virtual void deallocate( const T* const ptr ) override
+
+    inline void noteAllocated( PoolChunkT* chunk, pSzt nItems )
+    {
+        if ( !chunk->GetAtomLive().fetch_add( nItems ) )
+        {
+            _nIdleChunks.fetch_sub( 1 );
+        }
+    }
+    /**
+     * Called before the items are pushed back, so a chunk may look idle to 
+     * Trim() while some of its items are still on the way home. That is 
+     * safe because Trim() does not rely on the count: closeChunk() only 
+     * closes a chunk whose free list holds its whole capacity. Returns true 
+     * if the chunk became idle.
+     */
+    inline pBool noteFreed( PoolChunkT* chunk, pSzt nItems )
+    {
+        if ( chunk->GetAtomLive().fetch_sub( nItems ) == nItems )
+        {
+            _nIdleChunks.fetch_add( 1 );
+            return( true );
+        }
+        return( false );
+    }
+
+    pBool hasFree( PoolChunkT* chunk ) const
+    {
+        return( _addrTagger.GetCleanAddr( chunk->GetNextFreeItem() ) != nullptr );
+    }
+
+    /**
+     * A chunk with free items that no stripe allocates from, else the chunk 
+     * of the nearest stripe that still has free items.
+     */
+    PoolChunkT* findChunkWithFree( pSzt stripe ) const
     {
         PoolChunkT* cChunk = _headChunk.load()->GetNextChunk();
-        PoolItemT* cFreeItem = nullptr;
-        PoolItemT* itemToPut = (PoolItemT*) ptr;
+        while ( cChunk != _tailChunk.load() )
+        {
+            if ( hasFree( cChunk ) && !isAllocChunk( cChunk ) ) return( cChunk );
+            cChunk = cChunk->GetNextChunk();
+        }
+        for ( pSzt i( 1 ) ; i< _nStripes ; ++i )
+        {
+            PoolChunkT* nChunk = _allocStripes[ ( stripe + i ) % _nStripes ]._chunk.load();
+            if ( hasFree( nChunk ) ) return( nChunk );
+        }
+        return( nullptr );
+    }
 
-        do 
+    /**
+     * Called when the allocation chunk of stripe ran dry. Only the thread 
+     * that takes the chunk list switches it, to a chunk with free items or 
+     * else to a new one; the others back off and retry on whatever the 
+     * stripe's chunk is afterwards. Returns false when the pool is 
+     * exhausted and may not, or with grow == false must not, grow.
+     */
+    pBool replaceAllocChunk( pSzt stripe, PoolChunkT* cAllocChunk, pBool grow )
+    {
+        auto probe = _instr.Begin( CasSite::ChunkGrowthRace );
+        if ( !lockChunkList( false ) )
+        {
+            probe.Retry();
+            _instr.End( CasSite::ChunkGrowthRace, probe );
+            std::this_thread::yield();
+            return( true );
+        }
+        _instr.End( CasSite::ChunkGrowthRace, probe );
+        pBool canRetry( true );
+        std::atomic<PoolChunkT*>& stripeChunk = _allocStripes[ stripe ]._chunk;
+        if ( stripeChunk.load() == cAllocChunk )
         {
-            cFreeItem = cChunk->GetNextFreeItem();
-            PoolItemT* cleanFreeItem = _addrTagger.GetCleanAddr( cFreeItem );
-            PoolItemT* cleanItemToPut = _addrTagger.GetCleanAddr( itemToPut );
+            PoolChunkT* fChunk = findChunkWithFree( stripe );
+            if ( !fChunk && grow ) fChunk = createInsertNewChunk();
+            if ( fChunk )
+            {
+                stripeChunk.store( fChunk );
+            }
+            else
+            {
+                canRetry = false;
+            }
+        }
+        unlockChunkList();
+        return( canRetry );
+    }
+
+    PoolItemT* allocateItem( pSzt stripe, pBool grow = true )
+    {
+        PoolItemT* item = nullptr;
+        return( allocateItems( stripe, 1, [&]( PoolItemT* aItem ) { item = aItem; }, grow ) ? item : nullptr );
+    }
+
+    void deallocateItem( PoolItemT* item )
+    {
+        item = _addrTagger.GetCleanAddr( item );
+        PoolChunkT* chunk = PoolChunkT::ChunkOf( item, _chunkBlockAlign );
+        pBool becameIdle = noteFreed( chunk, 1 );
+        pushFreeItem( chunk, item );
+        if ( becameIdle ) maybeAutoTrim();
+    }
+
+    template<typename PutF> pSzt allocateItems( pSzt stripe, pSzt n, PutF&& put, pBool grow = true )
+    {
+        ChunkGuard guard( _epochDomain.get() );
+        pSzt nAlloc( 0 );
+        while ( nAlloc < n )
+        {
+            PoolChunkT* cAllocChunk = _allocStripes[ stripe ]._chunk.load();
+            PoolItemT* item = nullptr;
+            pSzt runLen = popFreeRun( cAllocChunk, n - nAlloc, item );
+            if ( !runLen )
+            {
+                if ( !replaceAllocChunk( stripe, cAllocChunk, grow ) ) break;
+                continue;
+            }
+            noteAllocated( cAllocChunk, runLen );
+            for ( pSzt i( 0 ) ; i< runLen ; ++i )
+            {
+                PoolItemT* nextItem = _addrTagger.GetCleanAddr( item->Next().load() );
+                put( item );
+                item = nextItem;
+            }
+            nAlloc += runLen;
+        }
+        return( nAlloc );
+    }
 
-            cleanItemToPut->_next.store( cFreeItem );
-            if ( cleanFreeItem )
+    /**
+     * Consecutive items of the same chunk are linked into one run and go 
+     * back with a single CAS per run.
+     */
+    template<typename P> pSzt deallocateItems( P const* ptrs, pSzt n )
+    {
+        pSzt nFreed( 0 );
+        PoolChunkT* runChunk = nullptr;
+        PoolItemT* firstItem = nullptr;
+        PoolItemT* lastItem = nullptr;
+        pSzt runLen( 0 );
+        pBool anyIdle( false );
+        for ( pSzt i( 0 ) ; i<= n ; ++i )
+        {
+            PoolItemT* item = nullptr;
+            PoolChunkT* chunk = nullptr;
+            if ( i < n )
+            {
+                if ( !ptrs[ i ] ) continue;
+                item = _addrTagger.GetCleanAddr( itemOf( ptrs[ i ] ) );
+                chunk = PoolChunkT::ChunkOf( item, _chunkBlockAlign );
+            }
+            if ( firstItem && chunk != runChunk )
+            {
+                anyIdle |= noteFreed( runChunk, runLen );
+                pushFreeRun( runChunk, firstItem, lastItem );
+                nFreed += runLen;
+                firstItem = nullptr;
+            }
+            if ( !item ) continue;
+            if ( firstItem )
             {
-                cleanItemToPut->SetAbaCount( cleanFreeItem->GetAbaCount() + 1 );
-                itemToPut = _addrTagger.TagAddr( cleanItemToPut, cleanItemToPut->GetAbaCount() );
+                lastItem->Next().store( item, std::memory_order_relaxed );
+                ++runLen;
             }
+            else
+            {
+                firstItem = item;
+                runChunk = chunk;
+                runLen = 1;
+            }
+            lastItem = item;
+        }
+        if ( anyIdle ) maybeAutoTrim();
+        return( nFreed );
+    }
+
+    T* allocate()
+    {
+        return( tryAllocate( true ) );
+    }
+    T* allocate( ThreadHint hint )
+    {
+        return( tryAllocate( hint, true ) );
+    }
+    /**
+     * grow == false only serves slots of existing chunks, so ShardedObjPool 
+     * can look for free slots in other shards before a shard grows.
+     */
+    T* tryAllocate( pBool grow )
+    {
+        PoolItemT* item = allocateItem( threadStripe(), grow );
+        if ( !item ) return( nullptr );
+        _nAllocs.Add( 1 );
+        return( item->Data() );
+    }
+    T* tryAllocate( ThreadHint hint, pBool grow )
+    {
+        if ( !_nMagazines )
+        {
+            PoolItemT* item = allocateItem( stripeOf( hint._id ), grow );
+            if ( !item ) return( nullptr );
+            _nAllocs.Add( 1 );
+            return( item->Data() );
+        }
+        Magazine& mag = magazineFor( hint._id );
+        pSzt count = mag._count.load( std::memory_order_relaxed );
+        if ( !count )
+        {
+            count = refillMagazine( mag, stripeOf( hint._id ), _magazineSize / 2, grow );
+            if ( !count ) return( nullptr );
         }
-        while ( !cChunk->CASNextFreeItem( cFreeItem, itemToPut ) );
+        PoolItemT* item = mag._items[ --count ];
+        mag._count.store( count, std::memory_order_relaxed );
+        countOwned( mag._nAllocs );
+        return( item->Data() );
     }
+    void deallocate( const T* const ptr ) noexcept
+    {
+        bumpGeneration( ptr );
+        deallocateItem( PoolItemT::FromData( ptr ) );
+        _nFrees.Add( 1 );
+        maybeProvision();
+    }
+    void deallocate( ThreadHint hint, const T* const ptr ) noexcept
+    {
+        if ( !_nMagazines )
+        {
+            deallocate( ptr );
+            return;
+        }
+        bumpGeneration( ptr );
+        Magazine& mag = magazineFor( hint._id );
+        pSzt count = mag._count.load( std::memory_order_relaxed );
+        if ( count == _magazineSize )
+        {
+            count = flushMagazine( mag, count, _magazineSize / 2 );
+        }
+        mag._items[ count ] = PoolItemT::FromData( ptr );
+        mag._count.store( count + 1, std::memory_order_relaxed );
+        countOwned( mag._nFrees );
+        maybeProvision();
+    }
+};
+
+/**
+ * Destroys the object and hands its slot back to the pool owning it.
+ */
+template<typename T, typename Traits = DefaultPoolTraits> struct PoolDeleter
+{
+    void operator()( T* ptr ) const noexcept
+    {
+        LockFreeObjPool<T, Traits>::OwnerOf( ptr )->Destruct( ptr );
+    }
+};
+
+/**
+ * Shared pointer to a pooled object whose reference count sits in the 
+ * object's slot, one pointer wide. Created by LockFreeObjPool::MakeShared.
+ */
+template<typename T, typename Traits = DefaultPoolTraits> class PoolSharedPtr
+{
+    using PoolItemT = PoolItem<T, typename Traits::ItemLayout>;
+
+    T* _ptr;
+
+    explicit PoolSharedPtr( T* ptr ) : _ptr( ptr ) {}
+
+    static std::atomic<pSzt>& refsOf( T* ptr )
+    {
+        return( PoolItemT::FromData( ptr )->Refs() );
+    }
+    void release()
+    {
+        if ( _ptr && refsOf( _ptr ).fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        {
+            PoolDeleter<T, Traits>()( _ptr );
+        }
+        _ptr = nullptr;
+    }
+
+    friend class LockFreeObjPool<T, Traits>;
+
+public:
+    PoolSharedPtr() : _ptr( nullptr ) {}
+    PoolSharedPtr( std::nullptr_t ) : _ptr( nullptr ) {}
+    PoolSharedPtr( const PoolSharedPtr& other ) : _ptr( other._ptr )
+    {
+        if ( _ptr ) refsOf( _ptr ).fetch_add( 1, std::memory_order_relaxed );
+    }
+    PoolSharedPtr( PoolSharedPtr&& other ) noexcept : _ptr( other._ptr )
+    {
+        other._ptr = nullptr;
+    }
+    ~PoolSharedPtr()
+    {
+        release();
+    }
+    PoolSharedPtr& operator=( PoolSharedPtr other ) noexcept
+    {
+        Swap( other );
+        return( *this );
+    }
+
+    void Swap( PoolSharedPtr& other ) noexcept
+    {
+        std::swap( _ptr, other._ptr );
+    }
+    void Reset()
+    {
+        release();
+    }
+
+    T* Get() const { return( _ptr ); }
+    T& operator*() const { return( *_ptr ); }
+    T* operator->() const { return( _ptr ); }
+    explicit operator bool() const { return( _ptr != nullptr ); }
+
+    pSzt UseCount() const
+    {
+        return( _ptr ? refsOf( _ptr ).load( std::memory_order_relaxed ) : 0 );
+    }
+
+    pBool operator==( const PoolSharedPtr& other ) const { return( _ptr == other._ptr ); }
+    pBool operator!=( const PoolSharedPtr& other ) const { return( _ptr != other._ptr ); }
 };
 
 } // namespace lfmem
@@ -0,0 +1,239 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <algorithm>
+
+#include "types.h"
+#include "addrTagger.h"
+#include "casInstrumentation.h"
+#include "chunkMemory.h"
+#include "backoff.h"
+
+namespace lfmem
+{
+
+/**
+ * Chunk growth counted in items: the first chunk holds InitialItems, every
+ * following one GrowthFactor times its predecessor, capped at MaxChunkItems.
+ * MaxChunks == 0 lets the pool grow without limit.
+ */
+template<pSzt InitialItems, pSzt GrowthFactor = 1, pSzt MaxChunkItems = InitialItems, pSzt MaxChunks = 0>
+struct ChunkGrowthPolicy
+{
+    static_assert( InitialItems > 0 && GrowthFactor > 0 && MaxChunkItems >= InitialItems, "invalid chunk growth policy" );
+
+    static constexpr pSzt maxChunks = MaxChunks;
+
+    static constexpr pSzt InitialChunkItems( pSzt /*itemSize*/ )
+    {
+        return( InitialItems );
+    }
+    static constexpr pSzt NextChunkItems( pSzt curItems, pSzt /*itemSize*/ )
+    {
+        return( std::min( curItems * GrowthFactor, MaxChunkItems ) );
+    }
+    static constexpr pSzt MaxItemsPerChunk( pSzt /*itemSize*/ )
+    {
+        return( MaxChunkItems );
+    }
+};
+
+/**
+ * Same as ChunkGrowthPolicy but sized in bytes, so pools of small and large
+ * objects get chunks of comparable footprint.
+ */
+template<pSzt InitialBytes, pSzt GrowthFactor = 1, pSzt MaxChunkBytes = InitialBytes, pSzt MaxChunks = 0>
+struct ChunkBytesGrowthPolicy
+{
+    static_assert( InitialBytes > 0 && GrowthFactor > 0 && MaxChunkBytes >= InitialBytes, "invalid chunk growth policy" );
+
+    static constexpr pSzt maxChunks = MaxChunks;
+
+    static constexpr pSzt InitialChunkItems( pSzt itemSize )
+    {
+        return( std::max<pSzt>( InitialBytes / itemSize, 1 ) );
+    }
+    static constexpr pSzt NextChunkItems( pSzt curItems, pSzt itemSize )
+    {
+        return( std::max<pSzt>( std::min( curItems * GrowthFactor, MaxChunkBytes / itemSize ), 1 ) );
+    }
+    static constexpr pSzt MaxItemsPerChunk( pSzt itemSize )
+    {
+        return( std::max<pSzt>( MaxChunkBytes / itemSize, 1 ) );
+    }
+};
+
+/**
+ * PoolItem keeps payload and free-list link side by side, the payload 
+ * aligned to Align.
+ */
+template<pSzt Align = 64> struct SplitItemLayout
+{
+    static constexpr pBool compact = false;
+
+    template<typename U> static constexpr pSzt SlotAlign()
+    {
+        static_assert( Align >= alignof(U) && !( Align & ( Align - 1 ) ), "invalid slot alignment" );
+        return( Align );
+    }
+};
+
+/**
+ * PoolItem overlays the free-list link on the payload of free slots. 
+ * Align 0 picks the natural alignment of the payload, at least 8; 
+ * otherwise one of 8, 16, 32 or 64. LowBitTagging needs 32 or 64 to keep 
+ * 32 tag values, HighBitTagging works with any of them.
+ */
+template<pSzt Align = 0> struct CompactItemLayout
+{
+    static constexpr pBool compact = true;
+
+    template<typename U> static constexpr pSzt SlotAlign()
+    {
+        constexpr pSzt slotAlign = Align ? Align : std::max<pSzt>( alignof(U), 8 );
+        static_assert( slotAlign >= alignof(U) && slotAlign >= 8 && slotAlign <= 64 && !( slotAlign & ( slotAlign - 1 ) ), 
+                       "slot alignment must be 8, 16, 32 or 64 and fit the payload" );
+        return( slotAlign );
+    }
+};
+
+/**
+ * Chunks are never released before the pool is destroyed.
+ */
+struct NoShrink
+{
+    static constexpr pBool enabled = false;
+    static constexpr pBool autoTrim = false;
+    static constexpr pSzt highIdleChunks = 0;
+    static constexpr pSzt lowIdleChunks = 0;
+};
+
+/**
+ * Completely free chunks may be released with LockFreeObjPool::Trim(). With 
+ * HighIdleChunks > 0 the pool trims itself once more than HighIdleChunks 
+ * chunks are idle, down to LowIdleChunks; the gap between the two is the 
+ * hysteresis that keeps bursty load from releasing and regrowing chunks.
+ */
+template<pSzt HighIdleChunks, pSzt LowIdleChunks = 0> struct IdleChunkShrink
+{
+    static_assert( LowIdleChunks <= HighIdleChunks, "low watermark above high watermark" );
+
+    static constexpr pBool enabled = true;
+    static constexpr pBool autoTrim = HighIdleChunks > 0;
+    static constexpr pSzt highIdleChunks = HighIdleChunks;
+    static constexpr pSzt lowIdleChunks = LowIdleChunks;
+};
+
+using ManualShrink = IdleChunkShrink<0, 0>;
+
+/**
+ * Every allocation is served from one allocation chunk.
+ */
+struct SingleFreeList
+{
+    static constexpr pSzt stripes = 1;
+};
+
+/**
+ * Allocations are spread over Stripes allocation chunks, picked by the 
+ * ThreadHint passed to Construct, so threads of different stripes pop from 
+ * different chunk heads. A stripe whose chunk runs dry moves to a free chunk 
+ * no other stripe uses, else shares a neighbour's chunk, and only then grows 
+ * the pool.
+ */
+template<pSzt Stripes> struct StripedFreeLists
+{
+    static_assert( Stripes > 0, "at least one stripe" );
+
+    static constexpr pSzt stripes = Stripes;
+};
+
+/**
+ * Objects are only referenced by pointer.
+ */
+struct NoHandles
+{
+    static constexpr pBool enabled = false;
+    static constexpr pSzt slotBits = 0;
+    static constexpr pSzt generationBits = 0;
+    static constexpr pSzt maxChunks = 0;
+    using HandleT = pUInt64;
+};
+
+/**
+ * Enables the handle front end of LockFreeObjPool: a handle packs a slot 
+ * index, i.e. chunk id * maximum items per chunk + item index, into the low 
+ * SlotBits and the slot's generation into the GenerationBits above them. 
+ * Every free bumps the generation, so handles to destroyed objects resolve 
+ * to nullptr until the generation wraps. Handles are 32 bits wide if both 
+ * fields fit, else 64. At most MaxChunks chunks exist at a time.
+ */
+template<pSzt SlotBits = 32, pSzt GenerationBits = 32, pSzt MaxChunks = 1024> struct GenerationalHandles
+{
+    static_assert( SlotBits > 0 && SlotBits < 64 && GenerationBits > 0 && GenerationBits <= 32 && SlotBits + GenerationBits <= 64, 
+                   "invalid handle layout" );
+    static_assert( MaxChunks > 0, "at least one chunk" );
+
+    static constexpr pBool enabled = true;
+    static constexpr pSzt slotBits = SlotBits;
+    static constexpr pSzt generationBits = GenerationBits;
+    static constexpr pSzt maxChunks = MaxChunks;
+    using HandleT = std::conditional_t<SlotBits + GenerationBits <= 32, pUInt32, pUInt64>;
+};
+
+/**
+ * The allocating thread that runs out of chunks builds the next one itself.
+ */
+struct InlineGrowth
+{
+    static constexpr pBool enabled = false;
+    static constexpr pBool background = false;
+    static constexpr pSzt lowWatermark = 0;
+    static constexpr pSzt highWatermark = 0;
+};
+
+/**
+ * Keeps up to HighWatermark pre-built chunks on a standby list, so growth 
+ * only splices one of them into the chunk list. Once no more than 
+ * LowWatermark are left, the list is refilled by a background thread per 
+ * pool, or with Background = false by the next Destruct on the pool.
+ */
+template<pSzt LowWatermark = 1, pSzt HighWatermark = 2, pBool Background = true> struct StandbyChunks
+{
+    static_assert( LowWatermark < HighWatermark, "the high watermark must exceed the low watermark" );
+
+    static constexpr pBool enabled = true;
+    static constexpr pBool background = Background;
+    static constexpr pSzt lowWatermark = LowWatermark;
+    static constexpr pSzt highWatermark = HighWatermark;
+};
+
+template<pSzt InitialItems, pSzt MaxChunkItems> using DoublingChunkGrowth = ChunkGrowthPolicy<InitialItems, 2, MaxChunkItems>;
+
+/**
+ * Compile-time configuration of LockFreeObjPool. Override single members by
+ * deriving, e.g. struct MyTraits : DefaultPoolTraits { using GrowthPolicy = ...; };
+ */
+struct DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<1000>;
+    using ItemLayout = SplitItemLayout<>;
+    using TagPolicy = LowBitTagging;
+    using ShrinkPolicy = NoShrink;
+    using Instrumentation = NoCasInstrumentation;
+    using StripePolicy = SingleFreeList;
+    using ChunkMemory = HeapChunkMemory;
+    using HandlePolicy = NoHandles;
+    using BackoffPolicy = NoBackoff;
+    using ProvisionPolicy = InlineGrowth;
+};
+
+} // namespace lfmem
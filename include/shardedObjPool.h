@@ -0,0 +1,162 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "types.h"
+#include "objectPool.h"
+#include "numaTopology.h"
+
+namespace lfmem
+{
+
+/**
+ * One LockFreeObjPool, i.e. one chunk list with its own free-list heads, per
+ * NUMA node or per group of CPUs. Allocations go to the shard of the CPU the
+ * caller runs on (sched_getcpu). Once its chunks have no free slot left, the
+ * free slots of the other shards are stolen before the local shard grows a
+ * new chunk, and the other shards only grow for it when the local shard may
+ * not. Frees go back to the shard that owns the chunk, whichever thread
+ * frees.
+ *
+ * In per-node mode every shard is built by a thread bound to its node, so
+ * its first chunk is first-touched there; later chunks are created by the
+ * allocating thread, which runs on the shard's node. On single-node machines
+ * there is exactly one shard and the pool behaves like LockFreeObjPool.
+ */
+template<typename T, typename Traits = DefaultPoolTraits> class ShardedObjPool : public StaticObjectPool<ShardedObjPool<T, Traits>, T>
+{
+    friend class StaticObjectPool<ShardedObjPool<T, Traits>, T>;
+
+    using ShardT = LockFreeObjPool<T, Traits>;
+
+    std::vector<std::unique_ptr<ShardT>> _shards;
+    pSztVec _cpuToShard;
+    std::atomic<pSzt> _nSteals;
+
+    pSzt shardOfCpu( pSzt cpu ) const
+    {
+        return( cpu < _cpuToShard.size() ? _cpuToShard[ cpu ] : cpu % _shards.size() );
+    }
+
+public:
+    /**
+     * nShards == 0 creates one shard per NUMA node, otherwise nShards shards
+     * over contiguous groups of CPUs. Magazines are per shard.
+     */
+    explicit ShardedObjPool( pSzt nShards = 0, pSzt nMagazines = 0, pSzt magazineSize = 64 )
+    {
+        NumaTopology const& topology = NumaTopology::System();
+        pBool perNode = !nShards;
+        pSzt nCpus = topology.CpuCount();
+        nShards = perNode ? topology.NodeCount() : nShards;
+
+        _cpuToShard.resize( nCpus );
+        for ( pSzt cpu( 0 ) ; cpu< nCpus ; ++cpu )
+        {
+            _cpuToShard[ cpu ] = perNode ? topology.NodeOfCpu( cpu ) : cpu * nShards / nCpus;
+        }
+
+        _shards.resize( nShards );
+        if ( perNode && nShards > 1 )
+        {
+            for ( pSzt node( 0 ) ; node< nShards ; ++node )
+            {
+                std::thread th( [&]()
+                                {
+                                    topology.BindCurrentThread( node );
+                                    _shards[ node ] = std::make_unique<ShardT>( nMagazines, magazineSize );
+                                } );
+                th.join();
+            }
+        }
+        else
+        {
+            for ( std::unique_ptr<ShardT>& shard : _shards ) shard = std::make_unique<ShardT>( nMagazines, magazineSize );
+        }
+        _nSteals.store( 0 );
+    }
+    ~ShardedObjPool() = default;
+
+    pSzt ShardCount() const { return( _shards.size() ); }
+    pSzt CurrentShard() const { return( shardOfCpu( NumaTopology::CurrentCpu() ) ); }
+    ShardT& Shard( pSzt idx ) { return( *_shards[ idx ] ); }
+
+    /**
+     * Allocations served by a shard other than the caller's.
+     */
+    pSzt StealCount() const { return( _nSteals.load() ); }
+
+    pSzt ChunkCount() const
+    {
+        pSzt n( 0 );
+        for ( std::unique_ptr<ShardT> const& shard : _shards ) n += shard->ChunkCount();
+        return( n );
+    }
+    pSzt Size() const
+    {
+        pSzt sz( 0 );
+        for ( std::unique_ptr<ShardT> const& shard : _shards ) sz += shard->Size();
+        return( sz );
+    }
+    PoolStats Stats() const
+    {
+        PoolStats st{};
+        for ( std::unique_ptr<ShardT> const& shard : _shards )
+        {
+            PoolStats sst = shard->Stats();
+            st.allocations += sst.allocations;
+            st.frees += sst.frees;
+            st.liveObjects += sst.liveObjects;
+            st.freeSlots += sst.freeSlots;
+            st.capacity += sst.capacity;
+            st.chunks += sst.chunks;
+            st.idleChunks += sst.idleChunks;
+            st.bytesReserved += sst.bytesReserved;
+            st.growthEvents += sst.growthEvents;
+            st.chunksReleased += sst.chunksReleased;
+            st.standbyChunks += sst.standbyChunks;
+        }
+        return( st );
+    }
+
+private:
+    template<typename... HintType> T* steal( pSzt local, pBool grow, HintType... hint )
+    {
+        T* ptr = nullptr;
+        for ( pSzt i( 1 ) ; !ptr && i< _shards.size() ; ++i )
+        {
+            ptr = _shards[ ( local + i ) % _shards.size() ]->tryAllocate( hint..., grow );
+        }
+        if ( ptr ) _nSteals.fetch_add( 1, std::memory_order_relaxed );
+        return( ptr );
+    }
+    template<typename... HintType> T* allocate( HintType... hint )
+    {
+        pSzt local = CurrentShard();
+        T* ptr = _shards[ local ]->tryAllocate( hint..., false );
+        if ( !ptr ) ptr = steal( local, false, hint... );
+        if ( !ptr ) ptr = _shards[ local ]->tryAllocate( hint..., true );
+        if ( !ptr ) ptr = steal( local, true, hint... );
+        return( ptr );
+    }
+    void deallocate( const T* const ptr ) noexcept
+    {
+        ShardT::OwnerOf( ptr )->deallocate( ptr );
+    }
+    void deallocate( ThreadHint hint, const T* const ptr ) noexcept
+    {
+        ShardT::OwnerOf( ptr )->deallocate( hint, ptr );
+    }
+};
+
+} // namespace lfmem
@@ -0,0 +1,178 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <memory_resource>
+
+#include "types.h"
+#include "objectPool.h"
+
+namespace lfmem
+{
+
+/**
+ * Lock-free std::pmr::memory_resource over one LockFreeObjPool per size
+ * class. Classes are the powers of two from 16 to 4096 bytes; a block of
+ * class S is aligned to min( S, 64 ). Requests above 4096 bytes or with a
+ * stricter alignment go to the upstream resource.
+ *
+ * Slots use the compact layout, so a block costs exactly its class size,
+ * with high-bit tags on the free-list heads since small classes leave no
+ * low pointer bits for them.
+ */
+class SlabResource : public std::pmr::memory_resource
+{
+public:
+    static constexpr pSzt minClassSize = 16;
+    static constexpr pSzt maxClassSize = 4096;
+    static constexpr pSzt nClasses = 9;
+
+private:
+    template<pSzt Size> struct alignas( Size < 64 ? Size : 64 ) Block
+    {
+        pChr _bytes[ Size ];
+    };
+
+    template<pSzt Size> struct SlabTraits : DefaultPoolTraits
+    {
+        using GrowthPolicy = ChunkBytesGrowthPolicy<16 * 1024, 2, 1024 * 1024>;
+        using ItemLayout = CompactItemLayout<( Size < 64 ? Size : 64 )>;
+        using TagPolicy = HighBitTagging;
+    };
+
+    struct SizeClassBase
+    {
+        virtual ~SizeClassBase() {}
+        virtual void* Allocate() = 0;
+        virtual void Free( void* block ) = 0;
+        virtual PoolStats Stats() const = 0;
+    };
+
+    template<pSzt Size> struct SizeClass : SizeClassBase
+    {
+        using BlockT = Block<Size>;
+
+        LockFreeObjPool<BlockT, SlabTraits<Size>> _pool;
+
+        void* Allocate() override
+        {
+            BlockT* block = nullptr;
+            return( _pool.AllocateBulk( 1, &block ) ? block : nullptr );
+        }
+        void Free( void* block ) override
+        {
+            _pool.Destruct( static_cast<BlockT*>( block ) );
+        }
+        PoolStats Stats() const override
+        {
+            return( _pool.Stats() );
+        }
+    };
+
+    std::unique_ptr<SizeClassBase> _classes[ nClasses ];
+    std::pmr::memory_resource* _upstream;
+
+    template<pSzt... Idx> void createClasses( std::index_sequence<Idx...> )
+    {
+        ( ( _classes[ Idx ] = std::make_unique<SizeClass<( minClassSize << Idx )>>() ), ... );
+    }
+
+    /**
+     * Index of the smallest class holding bytes at alignment align,
+     * nClasses if none does.
+     */
+    static pSzt classOf( pSzt bytes, pSzt align )
+    {
+        pSzt need = std::max( { bytes, align, minClassSize } );
+        if ( need > maxClassSize || align > 64 ) return( nClasses );
+        pSzt idx( 0 );
+        while ( ( minClassSize << idx ) < need ) ++idx;
+        return( idx );
+    }
+
+protected:
+    void* do_allocate( pSzt bytes, pSzt align ) override
+    {
+        pSzt idx = classOf( bytes, align );
+        if ( idx == nClasses ) return( _upstream->allocate( bytes, align ) );
+        void* block = _classes[ idx ]->Allocate();
+        if ( !block ) throw std::bad_alloc();
+        return( block );
+    }
+    void do_deallocate( void* block, pSzt bytes, pSzt align ) override
+    {
+        pSzt idx = classOf( bytes, align );
+        if ( idx == nClasses )
+        {
+            _upstream->deallocate( block, bytes, align );
+            return;
+        }
+        _classes[ idx ]->Free( block );
+    }
+    pBool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+    {
+        return( this == &other );
+    }
+
+public:
+    explicit SlabResource( std::pmr::memory_resource* upstream = std::pmr::new_delete_resource() )
+        : _upstream( upstream )
+    {
+        createClasses( std::make_index_sequence<nClasses>() );
+    }
+    SlabResource( const SlabResource& ) = delete;
+    SlabResource& operator=( const SlabResource& ) = delete;
+
+    static constexpr pSzt ClassSize( pSzt idx )
+    {
+        return( minClassSize << idx );
+    }
+    PoolStats Stats( pSzt idx ) const
+    {
+        return( _classes[ idx ]->Stats() );
+    }
+    std::pmr::memory_resource* Upstream() const
+    {
+        return( _upstream );
+    }
+};
+
+/**
+ * Rebinding STL allocator over a SlabResource for containers that do not
+ * take a polymorphic_allocator, e.g. std::list<T, SlabAllocator<T>>.
+ */
+template<typename T> class SlabAllocator
+{
+    SlabResource* _resource;
+
+    template<typename U> friend class SlabAllocator;
+
+public:
+    using value_type = T;
+
+    explicit SlabAllocator( SlabResource* resource ) noexcept : _resource( resource ) {}
+    template<typename U> SlabAllocator( const SlabAllocator<U>& other ) noexcept : _resource( other._resource ) {}
+
+    T* allocate( pSzt n )
+    {
+        return( static_cast<T*>( _resource->allocate( n * sizeof( T ), alignof( T ) ) ) );
+    }
+    void deallocate( T* ptr, pSzt n ) noexcept
+    {
+        _resource->deallocate( ptr, n * sizeof( T ), alignof( T ) );
+    }
+
+    SlabResource* Resource() const { return( _resource ); }
+
+    template<typename U> pBool operator==( const SlabAllocator<U>& other ) const { return( _resource == other._resource ); }
+    template<typename U> pBool operator!=( const SlabAllocator<U>& other ) const { return( _resource != other._resource ); }
+};
+
+} // namespace lfmem
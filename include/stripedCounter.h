@@ -0,0 +1,66 @@
+/************************************************************************/
+/*                    GNU AFFERO GENERAL PUBLIC LICENSE
+/*                       Version 3, 19 November 2007
+/*
+/* Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+/* Everyone is permitted to copy and distribute verbatim copies
+/* of this license document, but changing it is not allowed.
+/*
+/*************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include "types.h"
+
+namespace lfmem
+{
+
+/**
+ * Monotonic event counter spread over cache-line sized stripes. A thread 
+ * adds to the stripe picked by a hash of its id with a relaxed fetch_add, 
+ * so contention drops with the stripe count, but threads whose ids collide 
+ * still share a line. Paths with a single writer per counter, such as the 
+ * magazines of LockFreeObjPool, keep plain counts instead. Load() sums the 
+ * stripes and is only a snapshot under concurrency.
+ */
+template<pSzt NStripes = 16> class StripedCounter
+{
+    static_assert( NStripes > 0 && !( NStripes & ( NStripes - 1 ) ), "stripe count must be a power of two" );
+
+    struct alignas( 64 ) Stripe
+    {
+        std::atomic<pSzt> _value;
+    };
+
+    Stripe _stripes[ NStripes ];
+
+    static pSzt stripeIdx()
+    {
+        static thread_local pSzt idx = std::hash<pThreadId>()( std::this_thread::get_id() ) & ( NStripes - 1 );
+        return( idx );
+    }
+
+public:
+    StripedCounter()
+    {
+        for ( Stripe& s : _stripes ) s._value.store( 0, std::memory_order_relaxed );
+    }
+    StripedCounter( const StripedCounter& ) = delete;
+    StripedCounter& operator=( const StripedCounter& ) = delete;
+
+    inline void Add( pSzt n )
+    {
+        _stripes[ stripeIdx() ]._value.fetch_add( n, std::memory_order_relaxed );
+    }
+
+    pSzt Load() const
+    {
+        pSzt sum( 0 );
+        for ( Stripe const& s : _stripes ) sum += s._value.load( std::memory_order_relaxed );
+        return( sum );
+    }
+};
+
+} // namespace lfmem
@@ -25,9 +25,17 @@
 #include <set>
 #include <cstdint>
 
+#if defined( __GNUC__ )
+#define LF_NO_SANITIZE_THREAD __attribute__(( no_sanitize_thread ))
+#else
+#define LF_NO_SANITIZE_THREAD
+#endif
+
 typedef short pShort;
 typedef int pInt;
 typedef uintptr_t pUIntPtrT;
+typedef uint32_t pUInt32;
+typedef uint64_t pUInt64;
 typedef double pDbl;
 typedef char pChr;
 typedef bool pBool;
@@ -75,6 +83,13 @@ namespace pmath
 inline static pDbl AbsDbl(pDbl x) { return( std::fabs(x) ); }
 inline static pDbl FloorDbl(pDbl x) { return( std::floor(x) ); }
 
+template<class T> constexpr T CeilPow2(T x)
+{
+    T p(1);
+    while ( p < x ) p <<= 1;
+    return( p );
+}
+
 static constexpr pDbl intShift = 1E-8;
 
 static constexpr pInt billion  = 1000000000L;
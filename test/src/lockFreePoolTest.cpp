@@ -14,6 +14,10 @@
 #include <memory>
 #include <iterator>
 #include <algorithm>
+#include <list>
+#include <string>
+#include <stdexcept>
+#include <unordered_map>
 
 #include "gtest/gtest.h"
 
@@ -22,6 +26,11 @@
 #include "exception.h"
 #include "objectPool.h"
 #include "lockFreeStack.h"
+#include "lockFreeQueue.h"
+#include "epochReclaimer.h"
+#include "shardedObjPool.h"
+#include "slabResource.h"
+#include "fixedObjPool.h"
 
 using namespace lfmem;
 
@@ -68,7 +77,7 @@ TEST(LockFreePool, test0)
                                     {
                                         for ( pSzt n( 0 ) ; n< nnpt ; ++n )
                                         {
-                                            Dummy* nd = lfPool.Construct( thId, n );
+                                            Dummy* nd = lfPool.Construct( ThreadHint( thId ), thId, n );
                                             if ( !nd ) return;
                                             nodIdsVec[thId].push_back( nd->NodeID() );
                                             lfStack.Push( nd );
@@ -152,7 +161,7 @@ TEST(LockFreePool, test1)
                                     {
                                         for ( pSzt n( 0 ) ; n< nnpt ; ++n )
                                         {
-                                            Dummy* nd = lfPool.Construct( thId, n );
+                                            Dummy* nd = lfPool.Construct( ThreadHint( thId ), thId, n );
                                             if ( !nd ) return;
                                             nodIdsVec[thId].push_back( nd->NodeID() );
                                             lfStack.Push( nd );
@@ -181,4 +190,1315 @@ TEST(LockFreePool, test1)
     {
         errorMessage( ex );
     }
-}
\ No newline at end of file
+}
+TEST(LockFreePool, magazines)
+{
+    try
+    {
+        pSzt numThreads( 4 );
+        pSzt numNodesPerThread( 3000 );
+        LockFreeObjPool<Dummy> lfPool( numThreads, 32 );
+        LockFreeStack<Dummy> lfStack;
+
+        std::vector<std::thread> thVec; thVec.reserve( numThreads );
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pSzt thId, pSzt nnpt )
+                                {
+                                    std::vector<Dummy*> ndVec; ndVec.reserve( nnpt );
+                                    for ( pSzt n( 0 ) ; n< nnpt ; ++n )
+                                    {
+                                        Dummy* nd = lfPool.Construct( ThreadHint( thId ), thId, n );
+                                        ASSERT_NE( nd, nullptr );
+                                        ndVec.push_back( nd );
+                                        if ( n % 3 == 0 )
+                                        {
+                                            lfPool.Destruct( ThreadHint( thId ), ndVec.back() );
+                                            ndVec.pop_back();
+                                        }
+                                    }
+                                    for ( Dummy* nd : ndVec )
+                                    {
+                                        ASSERT_EQ( nd->ThreadID(), (pInt) thId );
+                                        lfStack.Push( nd );
+                                    }
+                                    lfPool.FlushMagazine( ThreadHint( thId ) );
+                                }, i, numNodesPerThread );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+
+        std::set<Dummy*> seen;
+        while ( !lfStack.IsEmpty() )
+        {
+            Dummy* nd = lfStack.Pop();
+            ASSERT_TRUE( seen.insert( nd ).second );
+        }
+        ASSERT_EQ( seen.size(), numThreads * ( numNodesPerThread - numNodesPerThread / 3 ) );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, bulk)
+{
+    try
+    {
+        pSzt numThreads( 4 );
+        pSzt batchSize( 150 );
+        pSzt numBatches( 40 );
+        LockFreeObjPool<Dummy> lfPool;
+        std::vector<std::vector<Dummy*>> keptVec( numThreads );
+
+        std::vector<std::thread> thVec; thVec.reserve( numThreads );
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pSzt thId )
+                                {
+                                    std::vector<Dummy*> batch( batchSize );
+                                    for ( pSzt b( 0 ) ; b< numBatches ; ++b )
+                                    {
+                                        ASSERT_EQ( lfPool.ConstructN( ThreadHint( thId ), batchSize, batch.data(), thId, (pInt) b ), batchSize );
+                                        for ( Dummy* nd : batch )
+                                        {
+                                            ASSERT_EQ( nd->ThreadID(), (pInt) thId );
+                                            ASSERT_EQ( nd->NodeID(), (pInt) b );
+                                        }
+                                        if ( b % 2 )
+                                        {
+                                            lfPool.DestructBulk( batch.data(), batchSize );
+                                        }
+                                        else
+                                        {
+                                            keptVec[ thId ].insert( keptVec[ thId ].end(), batch.begin(), batch.end() );
+                                        }
+                                    }
+                                }, i );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+
+        std::set<Dummy*> seen;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            for ( Dummy* nd : keptVec[ i ] )
+            {
+                ASSERT_EQ( nd->ThreadID(), (pInt) i );
+                ASSERT_TRUE( seen.insert( nd ).second );
+            }
+        }
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+struct DoublingTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<16, 2, 256>;
+};
+
+struct CappedTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<10, 1, 10, 2>;
+};
+
+TEST(LockFreePool, growthPolicy)
+{
+    try
+    {
+        LockFreeObjPool<Dummy, DoublingTraits> lfPool;
+        std::vector<Dummy*> ndVec( 1000 );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n )
+        {
+            ndVec[ n ] = lfPool.Construct( 0, n );
+            ASSERT_NE( ndVec[ n ], nullptr );
+        }
+        // 16 + 32 + 64 + 128 + 256 + 256 + 256 >= 1000
+        pSzt nFree = lfPool.Size();
+        for ( Dummy* nd : ndVec ) lfPool.Destruct( nd );
+        ASSERT_EQ( lfPool.ChunkCount(), 7 );
+        ASSERT_EQ( lfPool.Size(), nFree + ndVec.size() );
+
+        LockFreeObjPool<Dummy, CappedTraits> cappedPool;
+        for ( pSzt n( 0 ) ; n< 20 ; ++n )
+        {
+            ndVec[ n ] = cappedPool.Construct( 0, n );
+            ASSERT_NE( ndVec[ n ], nullptr );
+        }
+        ASSERT_EQ( cappedPool.Construct( 0, 20 ), nullptr );
+        ASSERT_FALSE( cappedPool.AddOneChunk() );
+        cappedPool.Destruct( ndVec[ 0 ] );
+        ASSERT_NE( cappedPool.Construct( 0, 21 ), nullptr );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+class SmallDummy
+{
+    pInt _thrId;
+    pInt _nodId;
+public:
+    explicit SmallDummy( pInt thrId, pInt nodId ) : _thrId( thrId ), _nodId( nodId ) {}
+
+    inline pInt NodeID() const { return( _nodId ); }
+    inline pInt ThreadID() const { return( _thrId ); }
+};
+
+template<pSzt Align> struct CompactTraits : DefaultPoolTraits
+{
+    using ItemLayout = CompactItemLayout<Align>;
+    using TagPolicy = HighBitTagging;
+};
+
+TEST(LockFreePool, compactLayout)
+{
+    static_assert( sizeof( PoolItem<SmallDummy, SplitItemLayout<>> ) == 128 );
+    static_assert( sizeof( PoolItem<SmallDummy, CompactItemLayout<>> ) == 8 );
+    static_assert( sizeof( PoolItem<SmallDummy, CompactItemLayout<32>> ) == 32 );
+    static_assert( sizeof( PoolItem<Dummy, CompactItemLayout<8>> ) == 8 );
+
+    try
+    {
+        pSzt numThreads( 4 );
+        pSzt numNodesPerThread( 2000 );
+        LockFreeObjPool<SmallDummy, CompactTraits<0>> lfPool;
+
+        std::vector<std::vector<SmallDummy*>> keptVec( numThreads );
+        std::vector<std::thread> thVec; thVec.reserve( numThreads );
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pSzt thId, pSzt nnpt )
+                                {
+                                    for ( pSzt n( 0 ) ; n< nnpt ; ++n )
+                                    {
+                                        SmallDummy* nd = lfPool.Construct( ThreadHint( thId ), thId, n );
+                                        ASSERT_NE( nd, nullptr );
+                                        ASSERT_EQ( reinterpret_cast<pUIntPtrT>( nd ) % 8, 0 );
+                                        if ( n % 2 ) lfPool.Destruct( nd );
+                                        else keptVec[ thId ].push_back( nd );
+                                    }
+                                }, i, numNodesPerThread );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+
+        std::set<SmallDummy*> seen;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            for ( pSzt n( 0 ) ; n< keptVec[ i ].size() ; ++n )
+            {
+                ASSERT_EQ( keptVec[ i ][ n ]->ThreadID(), (pInt) i );
+                ASSERT_EQ( keptVec[ i ][ n ]->NodeID(), (pInt) ( 2 * n ) );
+                ASSERT_TRUE( seen.insert( keptVec[ i ][ n ] ).second );
+            }
+        }
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+struct WideTagTraits : DefaultPoolTraits
+{
+    using ItemLayout = CompactItemLayout<8>;
+    using TagPolicy = HighBitTagging;
+};
+
+TEST(LockFreePool, highBitTagging)
+{
+    HighBitAddressTagger<SmallDummy> tagger;
+    SmallDummy sd( 0, 0 );
+    SmallDummy* tagged = tagger.TagAddr( &sd, 0x1ABCD );
+    ASSERT_EQ( tagger.GetTag( tagged ), 0xABCD );
+    ASSERT_EQ( tagger.GetCleanAddr( tagged ), &sd );
+    ASSERT_EQ( tagger.TagAddr( tagged, 1 ), nullptr );
+
+    try
+    {
+        pSzt numThreads( 4 );
+        pSzt numNodesPerThread( 20000 );
+        LockFreeObjPool<SmallDummy, WideTagTraits> lfPool;
+        std::atomic<pSzt> nErrors( 0 );
+
+        std::vector<std::thread> thVec; thVec.reserve( numThreads );
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pSzt thId, pSzt nnpt )
+                                {
+                                    std::vector<SmallDummy*> ndVec;
+                                    for ( pSzt n( 0 ) ; n< nnpt ; ++n )
+                                    {
+                                        ndVec.push_back( lfPool.Construct( ThreadHint( thId ), thId, n ) );
+                                        if ( ndVec.size() == 4 )
+                                        {
+                                            for ( SmallDummy* nd : ndVec )
+                                            {
+                                                if ( nd->ThreadID() != (pInt) thId ) nErrors++;
+                                                lfPool.Destruct( nd );
+                                            }
+                                            ndVec.clear();
+                                        }
+                                    }
+                                }, i, numNodesPerThread );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_EQ( nErrors.load(), 0 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, stackPooledNodes)
+{
+    try
+    {
+        pSzt numProducers( 4 );
+        pSzt numConsumers( 4 );
+        pSzt numNodesPerThread( 5000 );
+        std::vector<std::unique_ptr<Dummy>> nodes;
+        nodes.reserve( numProducers * numNodesPerThread );
+        for ( pSzt i( 0 ) ; i< numProducers * numNodesPerThread ; ++i )
+        {
+            nodes.push_back( std::make_unique<Dummy>( 0, i ) );
+        }
+        LockFreeStack<Dummy> lfStack;
+        std::vector<std::atomic<pInt>> popCounts( nodes.size() );
+        std::atomic<pSzt> nPopped( 0 );
+
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numProducers ; ++i )
+        {
+            thVec.emplace_back( [&]( pSzt thId )
+                                {
+                                    for ( pSzt n( 0 ) ; n< numNodesPerThread ; ++n )
+                                    {
+                                        lfStack.Push( nodes[ thId * numNodesPerThread + n ].get() );
+                                    }
+                                }, i );
+        }
+        for ( pSzt i( 0 ) ; i< numConsumers ; ++i )
+        {
+            thVec.emplace_back( [&]()
+                                {
+                                    while ( nPopped.load() < nodes.size() )
+                                    {
+                                        Dummy* nd = lfStack.Pop();
+                                        if ( !nd ) continue;
+                                        popCounts[ nd->NodeID() ]++;
+                                        nPopped++;
+                                    }
+                                } );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_TRUE( lfStack.IsEmpty() );
+        for ( auto const& pc : popCounts )
+        {
+            ASSERT_EQ( pc.load(), 1 );
+        }
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, epochReclamation)
+{
+    std::atomic<pInt> nReclaimed( 0 );
+    EpochDomain::ReclaimFn countFn = []( void* ctx, void* ) { ( *static_cast<std::atomic<pInt>*>( ctx ) )++; };
+    {
+        EpochDomain domain( 4, 1 );
+        auto retireSome = [&]( pInt n )
+                            {
+                                for ( pInt i( 0 ) ; i< n ; ++i )
+                                {
+                                    EpochDomain::Guard guard( &domain );
+                                    guard.Retire( nullptr, countFn, &nReclaimed );
+                                }
+                            };
+        {
+            EpochDomain::Guard reader( &domain );
+            std::thread th( retireSome, 10 );
+            th.join();
+            ASSERT_EQ( nReclaimed.load(), 0 );
+            ASSERT_LE( domain.Epoch(), 1 );
+        }
+        std::thread th( retireSome, 10 );
+        th.join();
+        ASSERT_GT( nReclaimed.load(), 0 );
+        ASSERT_LT( nReclaimed.load(), 20 );
+    }
+    ASSERT_EQ( nReclaimed.load(), 20 );
+}
+
+struct ManualShrinkTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<64>;
+    using ShrinkPolicy = ManualShrink;
+};
+
+struct AutoShrinkTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<64>;
+    using ShrinkPolicy = IdleChunkShrink<4, 1>;
+};
+
+TEST(LockFreePool, trim)
+{
+    try
+    {
+        LockFreeObjPool<Dummy, ManualShrinkTraits> lfPool;
+        std::vector<Dummy*> ndVec( 1000 );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n )
+        {
+            ndVec[ n ] = lfPool.Construct( 0, n );
+            ASSERT_NE( ndVec[ n ], nullptr );
+        }
+        pSzt nChunks = lfPool.ChunkCount();
+        ASSERT_EQ( nChunks, 16 );
+        ASSERT_EQ( lfPool.Trim( 0 ), 0 );
+
+        // Free every other chunk's worth of items, only those chunks go away.
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n )
+        {
+            if ( ( n / 64 ) % 2 ) continue;
+            lfPool.Destruct( ndVec[ n ] );
+            ndVec[ n ] = nullptr;
+        }
+        ASSERT_EQ( lfPool.IdleChunkCount(), 8 );
+        ASSERT_EQ( lfPool.Trim( 2 ), 6 );
+        ASSERT_EQ( lfPool.ChunkCount(), nChunks - 6 );
+        for ( Dummy* nd : ndVec )
+        {
+            if ( nd )
+            {
+                ASSERT_EQ( nd->ThreadID(), 0 );
+            }
+        }
+        for ( Dummy* nd : ndVec ) if ( nd ) lfPool.Destruct( nd );
+        lfPool.Trim( 0 );
+        ASSERT_EQ( lfPool.ChunkCount(), 1 );
+        ASSERT_EQ( lfPool.Size(), 64 );
+
+        LockFreeObjPool<Dummy, AutoShrinkTraits> autoPool;
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n ) ndVec[ n ] = autoPool.Construct( 0, n );
+        for ( Dummy* nd : ndVec ) autoPool.Destruct( nd );
+        ASSERT_LE( autoPool.IdleChunkCount(), 4 );
+        ASSERT_LT( autoPool.ChunkCount(), 16 );
+
+        pSzt numThreads( 3 );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pInt thId )
+                                {
+                                    std::vector<Dummy*> held( 300 );
+                                    for ( pSzt rc( 0 ) ; rc< 200 ; ++rc )
+                                    {
+                                        for ( pSzt n( 0 ) ; n< held.size() ; ++n )
+                                        {
+                                            held[ n ] = autoPool.Construct( ThreadHint( thId ), thId, n );
+                                            ASSERT_NE( held[ n ], nullptr );
+                                        }
+                                        for ( pSzt n( 0 ) ; n< held.size() ; ++n )
+                                        {
+                                            ASSERT_EQ( held[ n ]->ThreadID(), thId );
+                                            ASSERT_EQ( held[ n ]->NodeID(), n );
+                                        }
+                                        autoPool.DestructBulk( held.data(), held.size() );
+                                    }
+                                }, i );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_EQ( autoPool.Size(), autoPool.ChunkCount() * 64 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, ownerChunk)
+{
+    try
+    {
+        LockFreeObjPool<Dummy, ManualShrinkTraits> lfPool( 1, 64 );
+        std::vector<Dummy*> ndVec( 256 );
+        ASSERT_EQ( lfPool.AllocateBulk( ndVec.size(), ndVec.data() ), ndVec.size() );
+        ASSERT_EQ( lfPool.ChunkCount(), 4 );
+
+        // Every chunk gets back exactly the items it handed out.
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; n += 4 ) lfPool.Destruct( ndVec[ n ] );
+        for ( pSzt sz : lfPool.SizePerChunk() ) ASSERT_EQ( sz, 16 );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; n += 4 ) ndVec[ n ] = lfPool.Construct( 0, n );
+        for ( pSzt sz : lfPool.SizePerChunk() ) ASSERT_EQ( sz, 0 );
+
+        // Items freed in random order through a magazine come back in address order.
+        std::vector<Dummy*> firstChunk;
+        for ( pSzt n( 0 ) ; n< 64 ; ++n ) if ( n % 4 ) firstChunk.push_back( ndVec[ n ] );
+        std::vector<Dummy*> shuffled( firstChunk );
+        std::reverse( shuffled.begin(), shuffled.end() );
+        std::rotate( shuffled.begin(), shuffled.begin() + 17, shuffled.end() );
+        for ( Dummy* nd : shuffled ) lfPool.Destruct( ThreadHint( 0 ), nd );
+        lfPool.FlushMagazine( ThreadHint( 0 ) );
+        ASSERT_EQ( lfPool.AllocateBulk( firstChunk.size(), ndVec.data() ), firstChunk.size() );
+        ASSERT_EQ( lfPool.ChunkCount(), 4 );
+        std::sort( firstChunk.begin(), firstChunk.end() );
+        for ( pSzt n( 0 ) ; n< firstChunk.size() ; ++n ) ASSERT_EQ( ndVec[ n ], firstChunk[ n ] );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, stats)
+{
+    try
+    {
+        LockFreeObjPool<Dummy, ManualShrinkTraits> lfPool( 2, 16 );
+        PoolStats st = lfPool.Stats();
+        ASSERT_EQ( st.capacity, 64 );
+        ASSERT_EQ( st.chunks, 1 );
+        ASSERT_EQ( st.growthEvents, 0 );
+        ASSERT_GE( st.bytesReserved, 64 * sizeof( Dummy ) );
+
+        std::vector<Dummy*> ndVec( 200 );
+        for ( pSzt n( 0 ) ; n< 100 ; ++n ) ndVec[ n ] = lfPool.Construct( 0, n );
+        ASSERT_EQ( lfPool.AllocateBulk( 100, &ndVec[ 100 ] ), 100 );
+        st = lfPool.Stats();
+        ASSERT_EQ( st.allocations, 200 );
+        ASSERT_EQ( st.liveObjects, 200 );
+        ASSERT_EQ( st.chunks, 4 );
+        ASSERT_EQ( st.growthEvents, 3 );
+        ASSERT_EQ( st.freeSlots, st.capacity - 200 );
+
+        for ( pSzt n( 0 ) ; n< 50 ; ++n ) lfPool.Destruct( ThreadHint( 1 ), ndVec[ n ] );
+        lfPool.DestructBulk( &ndVec[ 50 ], 150 );
+        st = lfPool.Stats();
+        ASSERT_EQ( st.frees, 200 );
+        ASSERT_EQ( st.liveObjects, 0 );
+        ASSERT_EQ( st.freeSlots, st.capacity );
+        ASSERT_EQ( lfPool.Size(), st.capacity );
+
+        lfPool.FlushMagazine( ThreadHint( 0 ) );
+        lfPool.FlushMagazine( ThreadHint( 1 ) );
+        pSzt nReleased = lfPool.Trim( 0 );
+        st = lfPool.Stats();
+        ASSERT_EQ( st.chunksReleased, nReleased );
+        ASSERT_EQ( st.chunks, 4 - nReleased );
+        ASSERT_EQ( st.capacity, st.chunks * 64 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+struct InstrumentedTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<64>;
+    using Instrumentation = CasHistogramInstrumentation;
+};
+
+TEST(LockFreePool, casInstrumentation)
+{
+    static_assert( std::is_empty<NoCasInstrumentation>::value && std::is_empty<NoCasInstrumentation::Probe>::value, 
+                   "disabled instrumentation must not carry state" );
+    try
+    {
+        LockFreeObjPool<Dummy, InstrumentedTraits> lfPool;
+        LockFreeStack<Dummy, InstrumentedTraits> lfStack;
+        pSzt numThreads( 3 );
+        pSzt numNodesPerThread( 1000 );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pInt thId )
+                                {
+                                    for ( pSzt n( 0 ) ; n< numNodesPerThread ; ++n )
+                                    {
+                                        lfStack.Push( lfPool.Construct( ThreadHint( thId ), thId, n ) );
+                                    }
+                                    for ( pSzt n( 0 ) ; n< numNodesPerThread ; ++n )
+                                    {
+                                        Dummy* nd = lfStack.Pop();
+                                        if ( nd ) lfPool.Destruct( nd );
+                                    }
+                                }, i );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        while ( Dummy* nd = lfStack.Pop() ) lfPool.Destruct( nd );
+
+        pSzt nNodes = numThreads * numNodesPerThread;
+        CasHistogramInstrumentation const& poolInstr = lfPool.GetInstrumentation();
+        CasHistogramInstrumentation const& stackInstr = lfStack.GetInstrumentation();
+        ASSERT_EQ( stackInstr.Retries( CasSite::StackPush ).Count(), nNodes );
+        ASSERT_GE( stackInstr.Retries( CasSite::StackPop ).Count(), nNodes );
+        ASSERT_GE( poolInstr.Retries( CasSite::PoolAllocPop ).Count(), nNodes );
+        ASSERT_EQ( poolInstr.Retries( CasSite::PoolFreePush ).Count(), nNodes );
+        ASSERT_GT( poolInstr.Retries( CasSite::ChunkListLock ).Count(), 0 );
+        pSzt nRecorded( 0 );
+        LogHistogram const& pushRetries = stackInstr.Retries( CasSite::StackPush );
+        for ( pSzt b( 0 ) ; b< LogHistogram::nBuckets ; ++b ) nRecorded += pushRetries.BucketCount( b );
+        ASSERT_EQ( nRecorded, nNodes );
+        ASSERT_LE( pushRetries.Percentile( 0.5 ), pushRetries.Max() );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, shardedPool)
+{
+    try
+    {
+        ShardedObjPool<Dummy> nodePool;
+        ASSERT_EQ( nodePool.ShardCount(), NumaTopology::System().NodeCount() );
+        Dummy* nd = nodePool.Construct( 0, 1 );
+        ASSERT_NE( nd, nullptr );
+        ASSERT_EQ( LockFreeObjPool<Dummy>::OwnerOf( nd ), &nodePool.Shard( nodePool.CurrentShard() ) );
+        nodePool.Destruct( nd );
+
+        // Every shard holds at most 20 items in two chunks. The free slots of 
+        // the other shards are taken before the local shard grows.
+        ShardedObjPool<Dummy, CappedTraits> groupPool( 4 );
+        ASSERT_EQ( groupPool.ShardCount(), 4 );
+        std::vector<Dummy*> ndVec( 80 );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n )
+        {
+            ndVec[ n ] = groupPool.Construct( 0, n );
+            ASSERT_NE( ndVec[ n ], nullptr );
+            if ( n == 39 )
+            {
+                ASSERT_EQ( groupPool.StealCount(), 30 );
+                ASSERT_EQ( groupPool.ChunkCount(), 4 );
+            }
+        }
+        ASSERT_EQ( groupPool.Construct( 0, 80 ), nullptr );
+        ASSERT_EQ( groupPool.StealCount(), 60 );
+        ASSERT_EQ( groupPool.Size(), 0 );
+
+        std::thread th( [&]() { for ( Dummy* d : ndVec ) groupPool.Destruct( d ); } );
+        th.join();
+        for ( pSzt i( 0 ) ; i< groupPool.ShardCount() ; ++i )
+        {
+            ASSERT_EQ( groupPool.Shard( i ).Size(), 20 );
+        }
+        PoolStats st = groupPool.Stats();
+        ASSERT_EQ( st.allocations, 80 );
+        ASSERT_EQ( st.frees, 80 );
+        ASSERT_EQ( st.chunks, 8 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+struct StripedTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<64>;
+    using StripePolicy = StripedFreeLists<4>;
+};
+
+TEST(LockFreePool, stripedFreeLists)
+{
+    try
+    {
+        LockFreeObjPool<Dummy, StripedTraits> lfPool;
+        for ( pSzt i( 0 ) ; i< 4 ; ++i ) ASSERT_TRUE( lfPool.AddOneChunk() );
+
+        // All stripes start on the first chunk, once it runs dry each moves to a chunk of its own.
+        std::vector<Dummy*> ndVec;
+        for ( pSzt n( 0 ) ; n< 64 ; ++n ) ndVec.push_back( lfPool.Construct( 0, n ) );
+        for ( pInt thId( 0 ) ; thId< 4 ; ++thId ) ndVec.push_back( lfPool.Construct( ThreadHint( thId ), thId, 64 + thId ) );
+        ASSERT_EQ( lfPool.ChunkCount(), 5 );
+        std::vector<pSzt> sizes = lfPool.SizePerChunk();
+        std::sort( sizes.begin(), sizes.end() );
+        ASSERT_EQ( sizes, std::vector<pSzt>( { 0, 63, 63, 63, 63 } ) );
+        for ( Dummy* nd : ndVec ) lfPool.Destruct( nd );
+        ASSERT_EQ( lfPool.Size(), 5 * 64 );
+
+        pSzt numThreads( 4 );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pInt thId )
+                                {
+                                    std::vector<Dummy*> held( 100 );
+                                    for ( pSzt rc( 0 ) ; rc< 200 ; ++rc )
+                                    {
+                                        for ( pSzt n( 0 ) ; n< held.size() ; ++n ) held[ n ] = lfPool.Construct( ThreadHint( thId ), thId, n );
+                                        for ( pSzt n( 0 ) ; n< held.size() ; ++n )
+                                        {
+                                            ASSERT_EQ( held[ n ]->ThreadID(), thId );
+                                            ASSERT_EQ( held[ n ]->NodeID(), n );
+                                        }
+                                        for ( Dummy* nd : held ) lfPool.Destruct( nd );
+                                    }
+                                }, i );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_EQ( lfPool.Size(), lfPool.ChunkCount() * 64 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+template<HugePages Mode> struct MmapTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<64, 2, 4096>;
+    using ChunkMemory = MmapChunkMemory<Mode>;
+};
+
+TEST(LockFreePool, reserveMmapChunks)
+{
+    try
+    {
+        LockFreeObjPool<Dummy, MmapTraits<HugePages::Advise>> lfPool;
+        ASSERT_TRUE( lfPool.Reserve( 10000 ) );
+        PoolStats st = lfPool.Stats();
+        ASSERT_GE( st.capacity, 10000 );
+        std::vector<Dummy*> ndVec( 10000 );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n )
+        {
+            ndVec[ n ] = lfPool.Construct( 0, n );
+            ASSERT_NE( ndVec[ n ], nullptr );
+        }
+        ASSERT_EQ( lfPool.Stats().growthEvents, st.growthEvents );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n ) ASSERT_EQ( ndVec[ n ]->NodeID(), n );
+        for ( Dummy* nd : ndVec ) lfPool.Destruct( nd );
+
+        // Transparent huge pages need whole, aligned huge pages.
+        using AdviseMemory = MmapChunkMemory<HugePages::Advise>;
+        void* block = AdviseMemory::Allocate( 4096, 4096, false );
+        ASSERT_EQ( reinterpret_cast<pUIntPtrT>( block ) % ( 2 * 1024 * 1024 ), 0 );
+        ASSERT_EQ( AdviseMemory::MappedSize( 4096 ), 2 * 1024 * 1024 );
+        AdviseMemory::Release( block, 4096, 4096 );
+
+        // Without reserved huge pages this runs on the fallback mapping.
+        LockFreeObjPool<Dummy, MmapTraits<HugePages::HugeTlb>> tlbPool;
+        ASSERT_TRUE( tlbPool.Reserve( 1000, false ) );
+        for ( pSzt n( 0 ) ; n< 1000 ; ++n ) ndVec[ n ] = tlbPool.Construct( 0, n );
+        for ( pSzt n( 0 ) ; n< 1000 ; ++n ) ASSERT_EQ( ndVec[ n ]->NodeID(), n );
+        tlbPool.DestructBulk( ndVec.data(), 1000 );
+
+        LockFreeObjPool<Dummy, CappedTraits> cappedPool;
+        ASSERT_FALSE( cappedPool.Reserve( 100 ) );
+        ASSERT_EQ( cappedPool.ChunkCount(), 2 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, mpmcQueue)
+{
+    try
+    {
+        LockFreeQueue<Dummy> lfQueue( 100 );
+        ASSERT_EQ( lfQueue.Capacity(), 128 );
+        ASSERT_TRUE( lfQueue.IsEmpty() );
+        ASSERT_EQ( lfQueue.Pop(), nullptr );
+
+        std::vector<std::unique_ptr<Dummy>> nodes;
+        for ( pSzt n( 0 ) ; n< 200 ; ++n ) nodes.push_back( std::make_unique<Dummy>( 0, n ) );
+        std::vector<Dummy*> ptrs;
+        for ( auto const& nd : nodes ) ptrs.push_back( nd.get() );
+
+        // FIFO order, batches stop at the capacity.
+        ASSERT_TRUE( lfQueue.Push( ptrs[ 0 ] ) );
+        ASSERT_EQ( lfQueue.PushBatch( &ptrs[ 1 ], 199 ), 127 );
+        ASSERT_FALSE( lfQueue.Push( ptrs[ 199 ] ) );
+        std::vector<Dummy*> out( 200 );
+        ASSERT_EQ( lfQueue.PopBatch( out.data(), 10 ), 10 );
+        ASSERT_EQ( lfQueue.Pop(), ptrs[ 10 ] );
+        ASSERT_EQ( lfQueue.PopBatch( &out[ 11 ], 200 ), 117 );
+        for ( pSzt n( 0 ) ; n< 128 ; ++n )
+        {
+            if ( n != 10 )
+            {
+                ASSERT_EQ( out[ n ], ptrs[ n ] );
+            }
+        }
+        ASSERT_TRUE( lfQueue.IsEmpty() );
+
+        LockFreeObjPool<Dummy> lfPool;
+        LockFreeQueue<Dummy> handoff( 256 );
+        pSzt numProducers( 3 );
+        pSzt numConsumers( 3 );
+        pSzt numNodesPerThread( 3000 );
+        std::atomic<pSzt> nPopped( 0 );
+        std::atomic<pBool> ordered( true );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numProducers ; ++i )
+        {
+            thVec.emplace_back( [&]( pInt thId )
+                                {
+                                    for ( pSzt n( 0 ) ; n< numNodesPerThread ; ++n )
+                                    {
+                                        Dummy* nd = lfPool.Construct( ThreadHint( thId ), thId, n );
+                                        while ( !handoff.Push( nd ) ) std::this_thread::yield();
+                                    }
+                                }, i );
+        }
+        for ( pSzt i( 0 ) ; i< numConsumers ; ++i )
+        {
+            thVec.emplace_back( [&]()
+                                {
+                                    Dummy* batch[ 16 ];
+                                    while ( nPopped.load() < numProducers * numNodesPerThread )
+                                    {
+                                        pSzt nBatch = handoff.PopBatch( batch, 16 );
+                                        pInt prevThId( -1 );
+                                        pInt prevNodeId( -1 );
+                                        for ( pSzt b( 0 ) ; b< nBatch ; ++b )
+                                        {
+                                            // Items of one producer leave a single batch in order. The 
+                                            // previous item is already freed, so only its copied ids are used.
+                                            pInt thId = batch[ b ]->ThreadID();
+                                            pInt nodeId = batch[ b ]->NodeID();
+                                            if ( thId == prevThId && nodeId <= prevNodeId )
+                                            {
+                                                ordered.store( false );
+                                            }
+                                            prevThId = thId;
+                                            prevNodeId = nodeId;
+                                            lfPool.Destruct( batch[ b ] );
+                                        }
+                                        nPopped += nBatch;
+                                    }
+                                } );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_TRUE( ordered.load() );
+        ASSERT_TRUE( handoff.IsEmpty() );
+        ASSERT_EQ( nPopped.load(), numProducers * numNodesPerThread );
+        ASSERT_EQ( lfPool.Stats().liveObjects, 0 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+class CountedDummy
+{
+    pInt _thrId;
+    pInt _nodId;
+public:
+    static std::atomic<pInt> nAlive;
+
+    CountedDummy( pInt thrId, pInt nodId ) : _thrId( thrId ), _nodId( nodId ) { nAlive++; }
+    ~CountedDummy() { nAlive--; }
+
+    inline pInt NodeID() const { return( _nodId ); }
+};
+std::atomic<pInt> CountedDummy::nAlive( 0 );
+
+TEST(LockFreePool, smartPointers)
+{
+    static_assert( sizeof( PoolUniquePtr<CountedDummy> ) == sizeof( CountedDummy* ), "deleter must be stateless" );
+    static_assert( sizeof( PoolSharedPtr<CountedDummy> ) == sizeof( CountedDummy* ), "shared pointer must be one pointer" );
+    try
+    {
+        LockFreeObjPool<CountedDummy> lfPool;
+        {
+            PoolUniquePtr<CountedDummy> up = lfPool.MakeUnique( ThreadHint( 0 ), 0, 7 );
+            ASSERT_EQ( up->NodeID(), 7 );
+            ASSERT_EQ( CountedDummy::nAlive.load(), 1 );
+            ASSERT_EQ( lfPool.Stats().liveObjects, 1 );
+        }
+        ASSERT_EQ( CountedDummy::nAlive.load(), 0 );
+        ASSERT_EQ( lfPool.Stats().liveObjects, 0 );
+
+        PoolSharedPtr<CountedDummy> sp = lfPool.MakeShared( 0, 9 );
+        ASSERT_EQ( sp.UseCount(), 1 );
+        {
+            PoolSharedPtr<CountedDummy> sp2( sp );
+            PoolSharedPtr<CountedDummy> sp3;
+            sp3 = sp2;
+            ASSERT_EQ( sp.UseCount(), 3 );
+            ASSERT_EQ( sp3->NodeID(), 9 );
+        }
+        ASSERT_EQ( sp.UseCount(), 1 );
+
+        pSzt numThreads( 4 );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&, sp]()
+                                {
+                                    for ( pSzt n( 0 ) ; n< 10000 ; ++n )
+                                    {
+                                        PoolSharedPtr<CountedDummy> cp( sp );
+                                        ASSERT_EQ( cp->NodeID(), 9 );
+                                        PoolSharedPtr<CountedDummy> tmp = lfPool.MakeShared( ThreadHint( 1 ), 1, n );
+                                        ASSERT_EQ( tmp.UseCount(), 1 );
+                                    }
+                                } );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_EQ( sp.UseCount(), 1 );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 1 );
+        sp.Reset();
+        ASSERT_FALSE( sp );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 0 );
+        ASSERT_EQ( lfPool.Stats().liveObjects, 0 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, slabResource)
+{
+    try
+    {
+        SlabResource slab;
+        {
+            std::pmr::unordered_map<pInt, std::pmr::string> map( &slab );
+            for ( pInt i( 0 ) ; i< 1000 ; ++i )
+            {
+                map.emplace( i, std::pmr::string( 40 + i % 100, 'x' ) );
+            }
+            ASSERT_EQ( map.size(), 1000 );
+            ASSERT_EQ( map[ 500 ].size(), 40 );
+            pSzt nPooled( 0 );
+            for ( pSzt c( 0 ) ; c< SlabResource::nClasses ; ++c )
+            {
+                nPooled += slab.Stats( c ).liveObjects;
+            }
+            ASSERT_GE( nPooled, 2000 );
+        }
+        for ( pSzt c( 0 ) ; c< SlabResource::nClasses ; ++c )
+        {
+            ASSERT_EQ( slab.Stats( c ).liveObjects, 0 );
+        }
+
+        void* big = slab.allocate( 8192, 16 );
+        void* wide = slab.allocate( 32, 128 );
+        void* small = slab.allocate( 24, 8 );
+        ASSERT_EQ( reinterpret_cast<pUIntPtrT>( wide ) % 128, 0 );
+        ASSERT_EQ( reinterpret_cast<pUIntPtrT>( small ) % 32, 0 );
+        ASSERT_EQ( slab.Stats( 1 ).liveObjects, 1 );
+        slab.deallocate( big, 8192, 16 );
+        slab.deallocate( wide, 32, 128 );
+        slab.deallocate( small, 24, 8 );
+        ASSERT_EQ( slab.Stats( 1 ).liveObjects, 0 );
+
+        pSzt numThreads( 4 );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&, i]()
+                                {
+                                    std::list<pSzt, SlabAllocator<pSzt>> lst{ SlabAllocator<pSzt>( &slab ) };
+                                    for ( pSzt n( 0 ) ; n< 20000 ; ++n )
+                                    {
+                                        lst.push_back( n * numThreads + i );
+                                        if ( n % 3 == 0 ) lst.pop_front();
+                                    }
+                                    pSzt expected = ( 20000 + 2 ) / 3 * numThreads + i;
+                                    ASSERT_EQ( lst.front(), expected );
+                                } );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        for ( pSzt c( 0 ) ; c< SlabResource::nClasses ; ++c )
+        {
+            ASSERT_EQ( slab.Stats( c ).liveObjects, 0 );
+        }
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+class ThrowingDummy
+{
+    std::string _name;
+public:
+    explicit ThrowingDummy( const std::string& name ) : _name( name )
+    {
+        if ( name.empty() ) throw std::invalid_argument( "empty name" );
+    }
+
+    inline const std::string& Name() const { return( _name ); }
+};
+
+TEST(LockFreePool, staticInterface)
+{
+    static_assert( !std::is_polymorphic_v<LockFreeObjPool<Dummy>>, "the pool must not carry a vtable" );
+    try
+    {
+        LockFreeObjPool<CountedDummy> lfPool( 2 );
+        CountedDummy* nd = lfPool.Construct( 3, 4 );
+        ASSERT_EQ( nd->NodeID(), 4 );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 1 );
+        lfPool.Destruct( nd );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 0 );
+
+        nd = lfPool.Construct( ThreadHint( 1 ), 1, 5 );
+        lfPool.Destruct( ThreadHint( 1 ), nd );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 0 );
+        lfPool.FlushMagazine( ThreadHint( 1 ) );
+        ASSERT_EQ( lfPool.Stats().liveObjects, 0 );
+
+        std::vector<CountedDummy*> batch( 16 );
+        ASSERT_EQ( lfPool.ConstructN( batch.size(), batch.data(), 0, 6 ), batch.size() );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 16 );
+        lfPool.DestructBulk( batch.data(), batch.size() );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 0 );
+
+        LockFreeObjPool<ThrowingDummy> strPool;
+        ThrowingDummy* td = strPool.Construct( "slot" );
+        ASSERT_EQ( td->Name(), "slot" );
+        ASSERT_THROW( strPool.Construct( ThreadHint( 0 ), "" ), std::invalid_argument );
+        ASSERT_EQ( strPool.Stats().liveObjects, 1 );
+        strPool.Destruct( td );
+
+        ObjectPoolAdapter<LockFreeObjPool<CountedDummy>> adapter( lfPool );
+        BaseObjectPool<CountedDummy>& erased = adapter;
+        nd = erased.Construct( ThreadHint( 0 ), 0, 7 );
+        ASSERT_EQ( nd->NodeID(), 7 );
+        ASSERT_EQ( lfPool.Stats().liveObjects, 1 );
+        erased.Destruct( ThreadHint( 0 ), nd );
+        lfPool.FlushMagazine( ThreadHint( 0 ) );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 0 );
+        ASSERT_EQ( lfPool.Stats().liveObjects, 0 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, fixedPool)
+{
+    try
+    {
+        FixedObjPool<Dummy, 100> fixedPool;
+        ASSERT_EQ( fixedPool.Capacity(), 100 );
+        std::vector<Dummy*> ndVec( 100 );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n )
+        {
+            ndVec[ n ] = fixedPool.Construct( 0, n );
+            ASSERT_NE( ndVec[ n ], nullptr );
+        }
+        ASSERT_EQ( fixedPool.Size(), 0 );
+        ASSERT_EQ( fixedPool.Construct( 0, 100 ), nullptr );
+        for ( Dummy* nd : ndVec ) fixedPool.Destruct( nd );
+        ASSERT_EQ( fixedPool.Size(), 100 );
+
+        pSzt numThreads( 4 );
+        FixedObjPool<Dummy> sharedPool( numThreads * 64 );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&, i]()
+                                {
+                                    pInt thId = static_cast<pInt>( i );
+                                    std::vector<Dummy*> held( 64 );
+                                    for ( pSzt r( 0 ) ; r< 500 ; ++r )
+                                    {
+                                        for ( pSzt n( 0 ) ; n< held.size() ; ++n )
+                                        {
+                                            held[ n ] = sharedPool.Construct( thId, static_cast<pInt>( n ) );
+                                            ASSERT_NE( held[ n ], nullptr );
+                                        }
+                                        for ( pSzt n( 0 ) ; n< held.size() ; ++n )
+                                        {
+                                            ASSERT_EQ( held[ n ]->ThreadID(), thId );
+                                            ASSERT_EQ( held[ n ]->NodeID(), static_cast<pInt>( n ) );
+                                            sharedPool.Destruct( held[ n ] );
+                                        }
+                                    }
+                                } );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_EQ( sharedPool.Size(), sharedPool.Capacity() );
+
+        FixedObjPool<CountedDummy, 2, Exhaustion::HeapFallback> fallbackPool;
+        CountedDummy* cd[ 3 ];
+        for ( pInt n( 0 ) ; n< 3 ; ++n ) cd[ n ] = fallbackPool.Construct( 0, n );
+        ASSERT_EQ( fallbackPool.FallbackCount(), 1 );
+        ASSERT_FALSE( fallbackPool.Owns( cd[ 2 ] ) );
+        for ( CountedDummy* c : cd ) fallbackPool.Destruct( c );
+        ASSERT_EQ( CountedDummy::nAlive.load(), 0 );
+        ASSERT_EQ( fallbackPool.Size(), 2 );
+
+        FixedObjPool<Dummy, 1, Exhaustion::Wait> waitPool;
+        Dummy* first = waitPool.Construct( 0, 1 );
+        std::thread releaser( [&]()
+                              {
+                                  std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+                                  waitPool.Destruct( first );
+                              } );
+        Dummy* second = waitPool.Construct( 0, 2 );
+        releaser.join();
+        ASSERT_EQ( second, first );
+        waitPool.Destruct( second );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+struct HandleTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<100>;
+    using ShrinkPolicy = ManualShrink;
+    using HandlePolicy = GenerationalHandles<20, 12, 64>;
+};
+
+TEST(LockFreePool, generationalHandles)
+{
+    using HandlePoolT = LockFreeObjPool<Dummy, HandleTraits>;
+    static_assert( sizeof( HandlePoolT::Handle ) == 4, "20 + 12 bits must give 32-bit handles" );
+    try
+    {
+        HandlePoolT lfPool;
+        ASSERT_EQ( lfPool.Resolve( HandlePoolT::NullHandle ), nullptr );
+
+        std::vector<HandlePoolT::Handle> hVec( 1000 );
+        for ( pSzt n( 0 ) ; n< hVec.size() ; ++n )
+        {
+            hVec[ n ] = lfPool.ConstructHandle( 0, n );
+            ASSERT_NE( hVec[ n ], HandlePoolT::NullHandle );
+        }
+        ASSERT_EQ( lfPool.ChunkCount(), 10 );
+        for ( pSzt n( 0 ) ; n< hVec.size() ; ++n )
+        {
+            Dummy* nd = lfPool.Resolve( hVec[ n ] );
+            ASSERT_NE( nd, nullptr );
+            ASSERT_EQ( nd->NodeID(), static_cast<pInt>( n ) );
+            ASSERT_EQ( lfPool.HandleOf( nd ), hVec[ n ] );
+        }
+
+        Dummy* nd = lfPool.Resolve( hVec[ 7 ] );
+        lfPool.Destruct( nd );
+        ASSERT_EQ( lfPool.Resolve( hVec[ 7 ] ), nullptr );
+        ASSERT_FALSE( lfPool.DestructHandle( hVec[ 7 ] ) );
+        HandlePoolT::Handle reused = lfPool.ConstructHandle( 0, 7 );
+        ASSERT_EQ( lfPool.Resolve( reused ), nd );
+        ASSERT_EQ( lfPool.Resolve( hVec[ 7 ] ), nullptr );
+        hVec[ 7 ] = reused;
+
+        // Released chunks give their ids to new chunks, old handles stay stale.
+        for ( HandlePoolT::Handle h : hVec ) ASSERT_TRUE( lfPool.DestructHandle( h ) );
+        ASSERT_EQ( lfPool.Trim( 0 ), 9 );
+        for ( pSzt n( 0 ) ; n< 900 ; ++n ) ASSERT_NE( lfPool.ConstructHandle( 0, n ), HandlePoolT::NullHandle );
+        ASSERT_EQ( lfPool.ChunkCount(), 9 );
+        for ( HandlePoolT::Handle h : hVec ) ASSERT_EQ( lfPool.Resolve( h ), nullptr );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, stackElimination)
+{
+    try
+    {
+        pSzt numThreads( 12 );
+        pSzt numNodesPerThread( 4000 );
+        std::vector<std::unique_ptr<Dummy>> nodes;
+        nodes.reserve( numThreads * numNodesPerThread );
+        for ( pSzt i( 0 ) ; i< numThreads * numNodesPerThread ; ++i )
+        {
+            nodes.push_back( std::make_unique<Dummy>( 0, i ) );
+        }
+        LockFreeStack<Dummy> lfStack( 16 );
+        std::vector<std::atomic<pInt>> popCounts( nodes.size() );
+        std::atomic<pSzt> nPopped( 0 );
+
+        // Every thread pushes and pops alternately, so pushes and pops collide.
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&]( pSzt thId )
+                                {
+                                    for ( pSzt n( 0 ) ; n< numNodesPerThread ; ++n )
+                                    {
+                                        lfStack.Push( nodes[ thId * numNodesPerThread + n ].get() );
+                                        if ( Dummy* nd = lfStack.Pop() )
+                                        {
+                                            popCounts[ nd->NodeID() ]++;
+                                            nPopped++;
+                                        }
+                                    }
+                                }, i );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        while ( Dummy* nd = lfStack.Pop() )
+        {
+            popCounts[ nd->NodeID() ]++;
+            nPopped++;
+        }
+        ASSERT_EQ( nPopped.load(), nodes.size() );
+        for ( auto const& pc : popCounts )
+        {
+            ASSERT_EQ( pc.load(), 1 );
+        }
+        ASSERT_LE( lfStack.EliminatedCount(), nodes.size() );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}
+
+TEST(LockFreePool, backoffPolicies)
+{
+    // Every CAS loop creates a fresh policy, which starts at the minimum again.
+    ExponentialBackoff<2, 16> expBackoff;
+    pSztVec spins;
+    for ( pSzt i( 0 ) ; i< 5 ; ++i )
+    {
+        spins.push_back( expBackoff._spins );
+        expBackoff.Pause();
+    }
+    ASSERT_EQ( spins, pSztVec( { 2, 4, 8, 16, 16 } ) );
+    ASSERT_EQ( ( ExponentialBackoff<2, 16>()._spins ), 2 );
+
+    JitteredBackoff<1, 8> jitBackoff;
+    for ( pSzt i( 0 ) ; i< 5 ; ++i ) jitBackoff.Pause();
+    ASSERT_EQ( jitBackoff._bound, 8 );
+    ASSERT_EQ( ( JitteredBackoff<1, 8>()._bound ), 1 );
+
+    // The inner policy only runs for the first YieldAfter failures.
+    YieldingBackoff<3, ExponentialBackoff<1, 64>> yieldBackoff;
+    for ( pSzt i( 0 ) ; i< 6 ; ++i ) yieldBackoff.Pause();
+    ASSERT_EQ( yieldBackoff._nFailures, 6 );
+    ASSERT_EQ( yieldBackoff._inner._spins, 8 );
+
+    NoBackoff noBackoff;
+    noBackoff.Pause();
+    ASSERT_TRUE( ( std::is_same_v<DefaultPoolTraits::BackoffPolicy, NoBackoff> ) );
+}
+
+struct CooperativeStandbyTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<100>;
+    using ProvisionPolicy = StandbyChunks<1, 2, false>;
+};
+
+struct BackgroundStandbyTraits : DefaultPoolTraits
+{
+    using GrowthPolicy = ChunkGrowthPolicy<100>;
+    using ProvisionPolicy = StandbyChunks<1, 3, true>;
+};
+
+TEST(LockFreePool, standbyChunks)
+{
+    try
+    {
+        LockFreeObjPool<Dummy, CooperativeStandbyTraits> lfPool;
+        ASSERT_EQ( lfPool.Stats().standbyChunks, 2 );
+        // One chunk in the list and two on standby, all of the same size.
+        pSzt chunkBytes = lfPool.Stats().bytesReserved / 3;
+        ASSERT_EQ( lfPool.Stats().bytesReserved, 3 * chunkBytes );
+        std::vector<Dummy*> ndVec( 150 );
+        for ( pSzt n( 0 ) ; n< ndVec.size() ; ++n ) ndVec[ n ] = lfPool.Construct( 0, n );
+        ASSERT_EQ( lfPool.ChunkCount(), 2 );
+        ASSERT_EQ( lfPool.Stats().standbyChunks, 1 );
+        ASSERT_EQ( lfPool.Stats().bytesReserved, 3 * chunkBytes );
+        lfPool.Destruct( ndVec.back() );
+        ndVec.pop_back();
+        ASSERT_EQ( lfPool.Stats().standbyChunks, 2 );
+        ASSERT_EQ( lfPool.Stats().bytesReserved, 4 * chunkBytes );
+        for ( Dummy* nd : ndVec ) lfPool.Destruct( nd );
+
+        LockFreeObjPool<Dummy, BackgroundStandbyTraits> bgPool;
+        ASSERT_EQ( bgPool.Stats().standbyChunks, 3 );
+        pSzt numThreads( 4 );
+        std::vector<std::vector<Dummy*>> held( numThreads, std::vector<Dummy*>( 500 ) );
+        std::vector<std::thread> thVec;
+        for ( pSzt i( 0 ) ; i< numThreads ; ++i )
+        {
+            thVec.emplace_back( [&, i]()
+                                {
+                                    pInt thId = static_cast<pInt>( i );
+                                    for ( pSzt n( 0 ) ; n< held[ i ].size() ; ++n )
+                                    {
+                                        held[ i ][ n ] = bgPool.Construct( thId, n );
+                                        ASSERT_NE( held[ i ][ n ], nullptr );
+                                    }
+                                } );
+        }
+        for ( std::thread& th : thVec )
+        {
+            if ( th.joinable() ) th.join();
+        }
+        ASSERT_EQ( bgPool.ChunkCount(), 20 );
+        for ( std::vector<Dummy*>& thHeld : held )
+        {
+            for ( Dummy* nd : thHeld ) bgPool.Destruct( nd );
+        }
+        for ( pSzt w( 0 ) ; w< 500 && bgPool.Stats().standbyChunks < 3 ; ++w )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+        }
+        ASSERT_EQ( bgPool.Stats().standbyChunks, 3 );
+        ASSERT_EQ( bgPool.Stats().liveObjects, 0 );
+    }
+    catch ( LFException& ex )
+    {
+        errorMessage( ex );
+    }
+}